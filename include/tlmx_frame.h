@@ -0,0 +1,162 @@
+#ifndef TLMX_FRAME_H
+#define TLMX_FRAME_H
+
+////////////////////////////////////////////////////////////////////////////////
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+////////////////////////////////////////////////////////////////////////////////
+
+// Wire framing shared by the zedboard driver (C) and the SystemC adaptor (C++).
+//
+// Every packed tlmx_packet on a socket is preceded by a frame header. The
+// length lets a reader find frame boundaries in a byte stream regardless of how
+// TCP splits or coalesces segments, so several frames may be taken from one recv
+// and written with one writev. The tag is chosen by the client and returned
+// unchanged with the response, so a client may keep several requests
+// outstanding on one connection and match responses in whatever order they
+// complete.
+//
+//   +---------+---------+-------------------------------+
+//   | length  | tag     | packed tlmx_packet            |
+//   | 4 bytes | 4 bytes | (length bytes)                |
+//   +---------+---------+-------------------------------+
+//
+// Multi-byte header fields are big-endian (network order).
+
+#include <stdint.h>
+#include "tlmx_packet.h"
+
+typedef uint32_t tlmx_tag_t;
+
+#define TLMX_FRAME_LENGTH_INDEX 0
+#define TLMX_FRAME_TAG_INDEX    4
+#define TLMX_FRAME_HEADER_SIZE  8
+#define TLMX_MAX_FRAME          (TLMX_FRAME_HEADER_SIZE + TLMX_MAX_BUFFER)
+#define TLMX_MAX_WINDOW         32 /*< most requests outstanding on one connection */
+
+static inline void tlmx_frame_put32(char* buffer, uint32_t value)
+{
+  unsigned char* p = (unsigned char*)buffer;
+  p[0] = (unsigned char)(value >> 24);
+  p[1] = (unsigned char)(value >> 16);
+  p[2] = (unsigned char)(value >>  8);
+  p[3] = (unsigned char)(value      );
+}
+
+static inline uint32_t tlmx_frame_get32(const char* buffer)
+{
+  const unsigned char* p = (const unsigned char*)buffer;
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// Write the header at the start of frame; packed packet follows at
+// frame+TLMX_FRAME_HEADER_SIZE
+static inline void tlmx_frame_set_header(char* frame, uint32_t packed_size, tlmx_tag_t tag)
+{
+  tlmx_frame_put32(frame + TLMX_FRAME_LENGTH_INDEX, packed_size);
+  tlmx_frame_put32(frame + TLMX_FRAME_TAG_INDEX, tag);
+}
+
+// Total size of the frame (header included) starting at frame
+static inline int tlmx_frame_size(const char* frame)
+{
+  return TLMX_FRAME_HEADER_SIZE + (int)tlmx_frame_get32(frame + TLMX_FRAME_LENGTH_INDEX);
+}
+
+// A length beyond this is a corrupt or foreign stream
+static inline int tlmx_frame_size_ok(int frame_size)
+{
+  return frame_size >= TLMX_FRAME_HEADER_SIZE + TLMX_DATA_PTR_INDEX
+      && frame_size <= TLMX_MAX_FRAME;
+}
+
+static inline tlmx_tag_t tlmx_frame_tag(const char* frame)
+{
+  return tlmx_frame_get32(frame + TLMX_FRAME_TAG_INDEX);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Extended commands. These travel in tlmx_packet::command alongside the base
+// tlmx_command_t values and are numbered well clear of them.
+////////////////////////////////////////////////////////////////////////////////
+
+// TLMX_BATCH carries a list of register operations in the packet's data. The
+// packet address holds the number of operations. The adaptor executes them in
+// order in one SystemC activation, fills in each status (and read data) in
+// place and returns the whole packet. The packet status is TLMX_OK_RESPONSE
+// only if every operation succeeded.
+//
+//   +---------+--------+----------+-----------+---------------------+
+//   | command | status | data_len | address   | data (data_len)     |
+//   | 1 byte  | 1 byte | 2 bytes  | 8 bytes   | write in / read out |
+//   +---------+--------+----------+-----------+---------------------+
+//   repeated for each operation
+#define TLMX_BATCH ((tlmx_command_t)0x40)
+
+// TLMX_FENCE carries no data. Its response is returned only once everything
+// sent before it on the same connection has been performed, and its status
+// reports any posted write (see the simulator's -posted option) that failed
+// since the last TLMX_READ or TLMX_FENCE.
+#define TLMX_FENCE ((tlmx_command_t)0x41)
+
+#define TLMX_BATCH_COMMAND_INDEX  0
+#define TLMX_BATCH_STATUS_INDEX   1
+#define TLMX_BATCH_LENGTH_INDEX   2
+#define TLMX_BATCH_ADDRESS_INDEX  4
+#define TLMX_BATCH_OP_HEADER_SIZE 12
+
+static inline void tlmx_batch_set_op
+( char* op, tlmx_command_t command, uint64_t address, uint16_t data_len )
+{
+  unsigned char* p = (unsigned char*)op;
+  p[TLMX_BATCH_COMMAND_INDEX]   = (unsigned char)command;
+  p[TLMX_BATCH_STATUS_INDEX]    = (unsigned char)TLMX_INCOMPLETE_RESPONSE;
+  p[TLMX_BATCH_LENGTH_INDEX]    = (unsigned char)(data_len >> 8);
+  p[TLMX_BATCH_LENGTH_INDEX+1]  = (unsigned char)(data_len     );
+  tlmx_frame_put32(op + TLMX_BATCH_ADDRESS_INDEX,   (uint32_t)(address >> 32));
+  tlmx_frame_put32(op + TLMX_BATCH_ADDRESS_INDEX+4, (uint32_t)(address      ));
+}
+
+static inline tlmx_command_t tlmx_batch_command(const char* op)
+{
+  return (tlmx_command_t)((const unsigned char*)op)[TLMX_BATCH_COMMAND_INDEX];
+}
+
+static inline tlmx_status_t tlmx_batch_status(const char* op)
+{
+  return (tlmx_status_t)((const unsigned char*)op)[TLMX_BATCH_STATUS_INDEX];
+}
+
+static inline void tlmx_batch_set_status(char* op, tlmx_status_t status)
+{
+  ((unsigned char*)op)[TLMX_BATCH_STATUS_INDEX] = (unsigned char)status;
+}
+
+static inline uint16_t tlmx_batch_data_len(const char* op)
+{
+  const unsigned char* p = (const unsigned char*)op;
+  return (uint16_t)((p[TLMX_BATCH_LENGTH_INDEX] << 8) | p[TLMX_BATCH_LENGTH_INDEX+1]);
+}
+
+static inline uint64_t tlmx_batch_address(const char* op)
+{
+  return ((uint64_t)tlmx_frame_get32(op + TLMX_BATCH_ADDRESS_INDEX) << 32)
+       |  (uint64_t)tlmx_frame_get32(op + TLMX_BATCH_ADDRESS_INDEX+4);
+}
+
+// Size of the whole operation record (header plus data)
+static inline int tlmx_batch_op_size(const char* op)
+{
+  return TLMX_BATCH_OP_HEADER_SIZE + tlmx_batch_data_len(op);
+}
+
+#endif /*TLMX_FRAME_H*/
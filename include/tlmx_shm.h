@@ -0,0 +1,276 @@
+#ifndef TLMX_SHM_H
+#define TLMX_SHM_H
+
+////////////////////////////////////////////////////////////////////////////////
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+////////////////////////////////////////////////////////////////////////////////
+
+// Shared-memory transport shared by the zedboard driver (C) and the SystemC
+// adaptor (C++) when both run on one host.
+//
+// The adaptor creates a POSIX shared memory segment holding two single-producer
+// single-consumer byte rings: to_sysc carries request frames from the driver
+// and fm_sysc carries response frames back. Frames are exactly those of
+// tlmx_frame.h, so tags, batching and the packet encoding are unchanged.
+//
+// Neither side makes a system call while the other is keeping up. A consumer
+// that finds its ring empty spins briefly, then advertises that it is waiting
+// and sleeps on a futex on the ring's head. The producer only issues a wake-up
+// if it sees that flag after publishing. Full rings are handled the same way
+// on the tail. Both sides are sized so that a full window of frames always fits
+// (see TLMX_SHM_RING_SIZE), hence neither ever blocks the other for long.
+//
+// One driver may attach to a segment at a time.
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "tlmx_frame.h"
+
+#define TLMX_SHM_MAGIC      0x544c4d58u /* "TLMX" */
+#define TLMX_SHM_RING_FRAMES (2*TLMX_MAX_WINDOW) /* full-size frames each ring must hold */
+#define TLMX_SHM_SPIN       1000        /* polls before sleeping */
+
+/* Bytes per ring: the next power of two that holds TLMX_SHM_RING_FRAMES
+ * full-size frames, found by smearing the top bit of (frames*size - 1) down.
+ */
+#define TLMX_SHM_RING_NEED_ ((uint32_t)(TLMX_SHM_RING_FRAMES*TLMX_MAX_FRAME) - 1u)
+#define TLMX_SHM_RING_S1_   (TLMX_SHM_RING_NEED_ | (TLMX_SHM_RING_NEED_ >>  1))
+#define TLMX_SHM_RING_S2_   (TLMX_SHM_RING_S1_   | (TLMX_SHM_RING_S1_   >>  2))
+#define TLMX_SHM_RING_S4_   (TLMX_SHM_RING_S2_   | (TLMX_SHM_RING_S2_   >>  4))
+#define TLMX_SHM_RING_S8_   (TLMX_SHM_RING_S4_   | (TLMX_SHM_RING_S4_   >>  8))
+#define TLMX_SHM_RING_S16_  (TLMX_SHM_RING_S8_   | (TLMX_SHM_RING_S8_   >> 16))
+#define TLMX_SHM_RING_SIZE  (TLMX_SHM_RING_S16_ + 1u)
+#define TLMX_SHM_RING_MASK  (TLMX_SHM_RING_SIZE-1)
+
+/* Compile-time checks: a window of full-size frames fits, and the free-running
+ * 32-bit indices can tell a full ring from an empty one */
+typedef char tlmx_shm_ring_size_check[(TLMX_SHM_RING_SIZE >= TLMX_SHM_RING_FRAMES*TLMX_MAX_FRAME
+                                    && TLMX_SHM_RING_SIZE <= (1u<<31)) ? 1 : -1];
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TLMX_SHM_PAUSE() __builtin_ia32_pause()
+#else
+#define TLMX_SHM_PAUSE() do {} while (0)
+#endif
+
+/* Producer and consumer indices live on separate cache lines. Indices are
+ * free-running byte counts; position in data is index & TLMX_SHM_RING_MASK.
+ */
+typedef struct {
+  uint32_t head;             /*< bytes produced; consumer sleeps on this */
+  uint32_t consumer_waiting; /*< consumer is (about to be) asleep */
+  char     head_pad[56];
+  uint32_t tail;             /*< bytes consumed; producer sleeps on this */
+  uint32_t producer_waiting; /*< producer is (about to be) asleep */
+  char     tail_pad[56];
+  char     data[TLMX_SHM_RING_SIZE];
+} tlmx_shm_ring_t;
+
+typedef struct {
+  uint32_t        magic;     /*< set last by the creator */
+  uint32_t        attached;  /*< a driver is using the segment */
+  char            pad[56];
+  tlmx_shm_ring_t to_sysc;   /*< requests: driver -> adaptor */
+  tlmx_shm_ring_t fm_sysc;   /*< responses: adaptor -> driver */
+} tlmx_shm_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// Futex wrappers (shared, not process-private, as the segment spans processes)
+static inline void tlmx_shm_futex_wait(uint32_t* word, uint32_t expected)
+{
+  syscall(SYS_futex, word, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+static inline void tlmx_shm_futex_wake(uint32_t* word)
+{
+  syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Ring operations
+
+// Bytes free for the producer
+static inline uint32_t tlmx_shm_ring_space(tlmx_shm_ring_t* ring)
+{
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  return TLMX_SHM_RING_SIZE - (head - tail);
+}
+
+// Producer: append one frame. Returns 0, or -1 (writing nothing) if it does not fit.
+static inline int tlmx_shm_ring_put(tlmx_shm_ring_t* ring, const char* frame, uint32_t size)
+{
+  uint32_t head  = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  uint32_t tail  = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  uint32_t at    = head & TLMX_SHM_RING_MASK;
+  uint32_t first = TLMX_SHM_RING_SIZE - at;
+  if (TLMX_SHM_RING_SIZE - (head - tail) < size) return -1;
+  if (first > size) first = size;
+  memcpy(ring->data + at, frame, first);
+  memcpy(ring->data, frame + first, size - first);
+  __atomic_store_n(&ring->head, head + size, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&ring->consumer_waiting, __ATOMIC_SEQ_CST)) {
+    tlmx_shm_futex_wake(&ring->head);
+  }
+  return 0;
+}
+
+// Consumer: next whole frame, or NULL if none. A frame that wraps the end of the
+// ring is copied to scratch (TLMX_MAX_FRAME bytes). On a malformed length
+// *frame_size_ptr is set to -1 and NULL returned.
+static inline char* tlmx_shm_ring_peek(tlmx_shm_ring_t* ring, char* scratch, int* frame_size_ptr)
+{
+  uint32_t tail  = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+  uint32_t head  = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  uint32_t at    = tail & TLMX_SHM_RING_MASK;
+  uint32_t first = TLMX_SHM_RING_SIZE - at;
+  char     header[TLMX_FRAME_HEADER_SIZE];
+  int      frame_size;
+  *frame_size_ptr = 0;
+  if (head == tail) return NULL; /*< producers publish whole frames only */
+  if (first >= TLMX_FRAME_HEADER_SIZE) {
+    memcpy(header, ring->data + at, TLMX_FRAME_HEADER_SIZE);
+  } else {
+    memcpy(header, ring->data + at, first);
+    memcpy(header + first, ring->data, TLMX_FRAME_HEADER_SIZE - first);
+  }
+  frame_size = tlmx_frame_size(header);
+  if (!tlmx_frame_size_ok(frame_size) || (uint32_t)frame_size > head - tail) {
+    *frame_size_ptr = -1;
+    return NULL;
+  }
+  *frame_size_ptr = frame_size;
+  if (first >= (uint32_t)frame_size) return ring->data + at;
+  memcpy(scratch, ring->data + at, first);
+  memcpy(scratch + first, ring->data, frame_size - first);
+  return scratch;
+}
+
+// Consumer: release a frame obtained from tlmx_shm_ring_peek
+static inline void tlmx_shm_ring_consume(tlmx_shm_ring_t* ring, int frame_size)
+{
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+  __atomic_store_n(&ring->tail, tail + (uint32_t)frame_size, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&ring->producer_waiting, __ATOMIC_SEQ_CST)) {
+    tlmx_shm_futex_wake(&ring->tail);
+  }
+}
+
+// Consumer: nonzero if no frame is waiting (a snapshot; use before blocking)
+static inline int tlmx_shm_ring_empty(tlmx_shm_ring_t* ring)
+{
+  return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+}
+
+// Consumer: block until the ring holds data
+static inline void tlmx_shm_ring_wait_data(tlmx_shm_ring_t* ring)
+{
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+  uint32_t head;
+  for (int spin=0; spin!=TLMX_SHM_SPIN; ++spin) {
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != tail) return;
+    TLMX_SHM_PAUSE();
+  }
+  __atomic_store_n(&ring->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+  while ((head = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST)) == tail) {
+    tlmx_shm_futex_wait(&ring->head, head);
+  }
+  __atomic_store_n(&ring->consumer_waiting, 0, __ATOMIC_RELAXED);
+}
+
+// Producer: block until the ring has room for size bytes
+static inline void tlmx_shm_ring_wait_space(tlmx_shm_ring_t* ring, uint32_t size)
+{
+  uint32_t tail;
+  for (int spin=0; spin!=TLMX_SHM_SPIN; ++spin) {
+    if (tlmx_shm_ring_space(ring) >= size) return;
+    TLMX_SHM_PAUSE();
+  }
+  __atomic_store_n(&ring->producer_waiting, 1, __ATOMIC_SEQ_CST);
+  for (;;) {
+    tail = __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST);
+    if (TLMX_SHM_RING_SIZE - (__atomic_load_n(&ring->head, __ATOMIC_RELAXED) - tail) >= size) break;
+    tlmx_shm_futex_wait(&ring->tail, tail);
+  }
+  __atomic_store_n(&ring->producer_waiting, 0, __ATOMIC_RELAXED);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Segment management. Names follow shm_open(3), e.g. "/tlmx".
+
+// Adaptor: create (replacing any stale segment) and initialize. NULL on failure.
+static inline tlmx_shm_t* tlmx_shm_create(const char* name)
+{
+  tlmx_shm_t* shm;
+  int         fd;
+  shm_unlink(name);
+  fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL, 0600);
+  if (fd < 0) return NULL;
+  if (ftruncate(fd, sizeof(tlmx_shm_t)) < 0) {
+    close(fd);
+    return NULL;
+  }
+  shm = (tlmx_shm_t*)mmap(NULL, sizeof(tlmx_shm_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (shm == (tlmx_shm_t*)MAP_FAILED) return NULL;
+  __atomic_store_n(&shm->magic, TLMX_SHM_MAGIC, __ATOMIC_RELEASE); /*< rest zero from ftruncate */
+  return shm;
+}
+
+// Driver: attach to a segment created by the adaptor. NULL on failure; errno is
+// ENOENT while the adaptor has not yet created it and EBUSY if another driver
+// is attached.
+static inline tlmx_shm_t* tlmx_shm_attach(const char* name)
+{
+  tlmx_shm_t* shm;
+  struct stat info;
+  uint32_t    idle = 0;
+  int         fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) return NULL;
+  if (fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(tlmx_shm_t)) {
+    close(fd);
+    errno = ENOENT; /*< still being created */
+    return NULL;
+  }
+  shm = (tlmx_shm_t*)mmap(NULL, sizeof(tlmx_shm_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (shm == (tlmx_shm_t*)MAP_FAILED) return NULL;
+  if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != TLMX_SHM_MAGIC) {
+    munmap(shm, sizeof(tlmx_shm_t));
+    errno = ENOENT;
+    return NULL;
+  }
+  if (!__atomic_compare_exchange_n(&shm->attached, &idle, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    munmap(shm, sizeof(tlmx_shm_t));
+    errno = EBUSY;
+    return NULL;
+  }
+  return shm;
+}
+
+// Driver: release the segment so another driver may attach
+static inline void tlmx_shm_detach(tlmx_shm_t* shm)
+{
+  __atomic_store_n(&shm->attached, 0, __ATOMIC_RELEASE);
+  munmap(shm, sizeof(tlmx_shm_t));
+}
+
+#endif /*TLMX_SHM_H*/
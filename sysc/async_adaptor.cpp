@@ -9,7 +9,8 @@
 //
 // DETAILED DESCRIPTION:
 //
-// 1. Async_os_thread sets up TCP/IP socket to receive TLMX packets.
+// 1. Async_os_thread sets up TCP/IP socket to receive TLMX packets. Any number
+//    of clients may connect; their sockets are multiplexed with epoll.
 // 2. When a packet is received a push is executed on the thread-safe
 //    async_channel, which generates a SystemC event.
 // 3. initiator_thread wakes up, gets the data from the async_channel, formats
@@ -18,8 +19,9 @@
 // 4. Target processes and returns a response
 // 5. initiator_thread formats for TLMX and puts the response into the
 //    async_channel, which generates an OS event
-// 6. async_os_thread wakes up and pulls the data from async_channel and sends
-//    back to the external connection via the TCP/IP socket connection.
+// 6. async_os_thread wakes up (the channel's pull_fd is part of its epoll set)
+//    and pulls the data from async_channel and sends back to the originating
+//    external connection via the TCP/IP socket connection.
 //
 // +----------+  recv  +------+ push  +-------+ event +---------+           +------+
 // |External  |==TLMX=>|async |=tlmx=>|async  |------>|initiator|           |TLM2.0|
@@ -50,8 +52,29 @@
 
 #include "async_adaptor.h"
 #include "report.h"
+#include "tlmx_frame.h"
+#include "tlmx_stream.h"
+#include "tlmx_shm.h"
+#include "tlmx_pool.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#ifdef HAVE_LIBURING
+#include <deque>
+#include <liburing.h>
+#endif
 #include <sys/errno.h>
 #include <netdb.h>
 #include <arpa/inet.h>
@@ -67,26 +90,797 @@ namespace {
   // Embed file version information into object to help forensics
   static char const* const RCSID = "(@)$Id: async_adaptor.cpp  1.0 09/02/12 10:00 dcblack $";
   //                                        FILENAME  VER DATE     TIME  USERNAME
+
+  // epoll keys for async_os_thread; connections are numbered from FIRST_CONNECTION_KEY
+  const uint64_t LISTENER_KEY         = 0;
+  const uint64_t CHANNEL_KEY          = 1;
+  const uint64_t FIRST_CONNECTION_KEY = 2;
+  const int      MAX_EPOLL_EVENTS     = 64;
+
+  // Posted writes (-posted): a TLMX_WRITE is acknowledged as soon as it is
+  // queued for SystemC. The channel is in order, so later requests still see
+  // its effect. A failure is remembered and returned in place of success on the
+  // client's next TLMX_READ or TLMX_FENCE.
+  struct posting_t {
+    int           in_flight{0};               //< posted writes inside SystemC
+    tlmx_status_t deferred{TLMX_OK_RESPONSE}; //< first failure not yet reported
+
+    // On a request: true if it is posted and should be acknowledged now
+    bool post(tlmx_packet& packet, bool enabled)
+    {
+      if (not enabled or packet.command != TLMX_WRITE) return false;
+      packet.status = TLMX_OK_RESPONSE;
+      ++in_flight;
+      return true;
+    }
+
+    // On a response: true if it should be sent to the client
+    bool settle(tlmx_packet& packet, bool posted)
+    {
+      if (posted) {
+        --in_flight;
+        if (packet.status != TLMX_OK_RESPONSE) {
+          REPORT_WARNING("Posted " << packet.str() << " failed; reported on next read or fence");
+          if (deferred == TLMX_OK_RESPONSE) deferred = tlmx_status_t(packet.status);
+        }
+        return false;
+      }
+      if ((packet.command == TLMX_READ or packet.command == TLMX_FENCE) and deferred != TLMX_OK_RESPONSE) {
+        if (packet.status == TLMX_OK_RESPONSE) packet.status = deferred;
+        deferred = TLMX_OK_RESPONSE;
+      }
+      return true;
+    }
+  };
+
+  // State kept by async_os_thread for each remote client. Responses wait in
+  // writer; the writer is sized so that a full window of responses always fits
+  // on top of what may be queued when the last request was admitted (plus the
+  // answer to that request if it was a debug read served directly).
+  struct connection_t {
+    explicit connection_t(int socket_fd, int window)
+    : socket(socket_fd)
+    , writer(size_t(2*window+1)*TLMX_MAX_FRAME)
+    {}
+    int               socket;
+    int               outstanding{0}; //< requests inside SystemC
+    tlmx_lane_t       lane{TLMX_LANE_NORMAL}; //< of those requests
+    uint32_t          events{0};      //< epoll interest currently registered
+    posting_t         posting;
+    tlmx_frame_reader reader;
+    tlmx_frame_writer writer;
+  };
+
+  // Spin until found() reports work or the window closes. Each engine calls
+  // this before blocking so that, for latency-critical runs, a request that
+  // arrives soon after the last one does not pay for a sleep and a wake-up.
+  template<typename found_t>
+  bool busy_poll(chrono::microseconds window, async_os_stats_t& stats, found_t found)
+  {
+    if (window.count() == 0) return false;
+    auto deadline = chrono::steady_clock::now() + window;
+    do {
+      if (found()) {
+        stats.polled.fetch_add(1, memory_order_relaxed);
+        return true;
+      }
+    } while (chrono::steady_clock::now() < deadline);
+    return false;
+  }
+
+  // Pin the calling thread to a core and/or give it a real-time priority;
+  // failures (e.g. no CAP_SYS_NICE) are reported and otherwise ignored
+  void place_thread(const char* which, int cpu, int rt_priority)
+  {
+    if (cpu >= 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(cpu, &cpus);
+      int status = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      if (status != 0) {
+        REPORT_WARNING("Unable to pin " << which << " to CPU " << cpu << ": " << strerror(status));
+      }
+    }
+    if (rt_priority > 0) {
+      sched_param param;
+      param.sched_priority = rt_priority;
+      int status = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+      if (status != 0) {
+        REPORT_WARNING("Unable to give " << which << " SCHED_FIFO priority " << rt_priority << ": " << strerror(status));
+      }
+    }
+  }
+
+  // A client that closes with responses still queued is not an error of ours;
+  // either way only that connection is dropped
+  void report_send_failure(int error)
+  {
+    if (error == EPIPE or error == ECONNRESET) {
+      REPORT_INFO("Client closed with responses pending: " << strerror(error));
+    } else {
+      REPORT_ERROR("TCPIP write/send failed: " << strerror(error));
+    }
+  }
+
+  // Printable peer of an accepted connection, whichever family the listener is
+  string peer_name(const sockaddr_storage& peer)
+  {
+    char text[INET6_ADDRSTRLEN] = "";
+    switch (peer.ss_family) {
+      case AF_INET:
+        inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in&>(peer).sin_addr, text, sizeof(text));
+        return text;
+      case AF_INET6:
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6&>(peer).sin6_addr, text, sizeof(text));
+        return text;
+      case AF_UNIX: {
+        const sockaddr_un& local = reinterpret_cast<const sockaddr_un&>(peer);
+        return local.sun_path[0] != '\0' ? string("unix ") + local.sun_path : string("unix"); //< clients are usually unbound
+      }
+      default:
+        return "unknown";
+    }//endswitch
+  }
+
+  // Add/modify/remove socket in an epoll set
+  void watch(int epoll_fd, int operation, int fd, uint32_t events, uint64_t key)
+  {
+    epoll_event event;
+    event.events   = events;
+    event.data.u64 = key;
+    if (epoll_ctl(epoll_fd, operation, fd, &event) < 0) {
+      REPORT_ERROR("epoll_ctl failed: " << strerror(errno));
+    }
+  }
+
+  // Serve a TLMX_DEBUG_READ on the OS thread if the target allows it, so that
+  // peeks neither wait for nor disturb the simulation. Debug writes still go
+  // through SystemC, which keeps it the only writer of target storage. Reads
+  // the target declines (nothing transferred) go through SystemC as well.
+  bool serve_debug_read(async_debug_if* debug, tlmx_packet& packet)
+  {
+    if (debug == nullptr or packet.command != TLMX_DEBUG_READ) return false;
+    unsigned int transferred = debug->async_debug_read(packet.address, packet.data_ptr, packet.data_len);
+    if (transferred == 0) return false;
+    packet.status = (transferred == packet.data_len) ? TLMX_OK_RESPONSE : TLMX_ADDRESS_ERROR_RESPONSE;
+    return true;
+  }
+
+  // Pack a tagged response into its client's writer (sent on next flush)
+  void queue_response(connection_t& client, tlmx_tag_t tag, tlmx_packet_ptr& tlmx_trans_ptr)
+  {
+    // Check for errors and adjust
+    if (tlmx_trans_ptr->status != TLMX_OK_RESPONSE) {
+      REPORT_ERROR(tlmx_status_to_str(tlmx_status_t(tlmx_trans_ptr->status)));
+    }
+    char* frame = client.writer.reserve();
+    sc_assert(frame != nullptr); //< guaranteed by writer sizing
+    int packed_size = tlmx_trans_ptr->pack(frame + TLMX_FRAME_HEADER_SIZE);
+    tlmx_frame_set_header(frame, packed_size, tag);
+    client.writer.commit(TLMX_FRAME_HEADER_SIZE + packed_size);
+    REPORT_TRACE("Queued response tag " << tag << " ...");
+  }
+
+  // State shared by the socket engines of async_os_thread (epoll and io_uring):
+  // the connections and the requests they have inside SystemC
+  struct session_t {
+    typedef map<uint64_t,connection_t> connection_map;
+    session_t
+    ( tlmx_channel&        async_channel
+    , tlmx_packet_pool&    packet_pool
+    , int                  max_outstanding
+    , chrono::microseconds poll_window
+    , async_os_stats_t&    os_stats
+    , async_debug_if*      debug_target
+    , bool                 posted_writes
+    )
+    : channel(async_channel)
+    , pool(packet_pool)
+    , debug(debug_target)
+    , posted(posted_writes)
+    , stats(os_stats)
+    , poll(poll_window)
+    , window(max_outstanding)
+    , admit_limit(size_t(max_outstanding)*TLMX_MAX_FRAME)
+    {
+      answered.reserve(pool.capacity());
+      starved.reserve(pool.capacity());
+    }
+    tlmx_channel&                channel;
+    tlmx_packet_pool&            pool;        //< every packet inside SystemC
+    async_debug_if*              debug;       //< serves debug reads directly, if any
+    bool                         posted;      //< acknowledge writes early
+    async_os_stats_t&            stats;
+    chrono::microseconds         poll;        //< busy-poll before blocking
+    int                          window;
+    size_t                       admit_limit;
+    connection_map               connections; //< keyed by connection id
+    vector<uint64_t>             answered;    //< connections given responses by collect()
+    vector<uint64_t>             starved;     //< connections held back by the pool or channel
+    uint64_t                     next_id{FIRST_CONNECTION_KEY};
+    bool                         running{true};
+
+    // A connection may send more only while its window has room, its client
+    // is keeping up with responses, there is a packet to carry it and the
+    // channel is below its watermark. Otherwise its socket is not read and
+    // TCP flow control holds the client back.
+    bool admitting(const connection_t& client) const
+    {
+      return client.outstanding < window
+         and client.writer.pending() <= admit_limit
+         and pool.available() != 0
+         and channel.can_push();
+    }
+
+    // Unpack buffered frames and send them to SystemC while admitting
+    void dispatch(uint64_t key, connection_t& client)
+    {
+      int   frame_size;
+      char* frame;
+      while ( running
+          and admitting(client)
+          and (frame = client.reader.peek(frame_size)) != nullptr
+      ) {
+        tlmx_packet_pool::slot_t* slot = pool.acquire();
+        slot->connection = key;
+        slot->tag        = tlmx_frame_tag(frame);
+        tlmx_packet_ptr& tlmx_trans_ptr(slot->packet);
+        int unpacked_size = tlmx_trans_ptr->unpack(frame + TLMX_FRAME_HEADER_SIZE);
+        sc_assert(unpacked_size == frame_size - TLMX_FRAME_HEADER_SIZE);
+        client.reader.consume(frame_size);
+        REPORT_TRACE("Request to SystemC tag " << slot->tag << " " << tlmx_trans_ptr->str());
+
+        // Exit if commanded
+        if (tlmx_trans_ptr->command == TLMX_EXIT) {
+          REPORT_NOTE("Exiting due to TLMX_EXIT...");
+          pool.release(slot);
+          running = false;
+          break;
+        }
+
+        // Debug reads are served here only when the connection has nothing
+        // inside SystemC (posted or not), so they never overtake its own
+        // earlier requests
+        if (client.outstanding == 0 and serve_debug_read(debug, *tlmx_trans_ptr)) {
+          queue_response(client, slot->tag, tlmx_trans_ptr);
+          pool.release(slot);
+          continue;
+        }
+
+        slot->posted = client.posting.post(*tlmx_trans_ptr, posted);
+        if (slot->posted) {
+          queue_response(client, slot->tag, tlmx_trans_ptr);
+        }
+
+        // Lanes do not keep order between them, so a connection only
+        // changes lane once it has nothing inside SystemC
+        if (client.outstanding == 0) client.lane = tlmx_lane_of(*tlmx_trans_ptr);
+        ++client.outstanding;
+        stats.requests.fetch_add(1, memory_order_relaxed);
+        channel.push(tlmx_trans_ptr, client.lane);
+      }//endwhile
+      if ((pool.available() == 0 or not channel.can_push()) and (starved.empty() or starved.back() != key)) {
+        starved.push_back(key); //< resumed by collect()
+      }
+    }
+
+    // Pull every response from SystemC, queue it on its connection's writer
+    // and return its packet to the pool; answered lists the connections that
+    // now have data to send or, having been starved, may send more
+    void collect(void)
+    {
+      tlmx_packet_ptr tlmx_trans_ptr;
+      answered.clear();
+      while (channel.nb_pull(tlmx_trans_ptr)) {
+        REPORT_TRACE("Response from SystemC " << tlmx_trans_ptr->str());
+        tlmx_packet_pool::slot_t* slot = pool.find(*tlmx_trans_ptr);
+        if (slot == nullptr) {
+          REPORT_ERROR("Response without matching request " << tlmx_trans_ptr->str());
+          continue;
+        }
+        auto owner = connections.find(slot->connection);
+        if (owner == connections.end()) {
+          REPORT_NOTE("Dropping response for closed connection");
+          pool.release(slot);
+          continue;
+        }
+        if (owner->second.posting.settle(*tlmx_trans_ptr, slot->posted)) {
+          queue_response(owner->second, slot->tag, tlmx_trans_ptr);
+        }
+        pool.release(slot);
+        --owner->second.outstanding;
+        if (answered.empty() or answered.back() != owner->first) {
+          answered.push_back(owner->first);
+        }
+      }//endwhile
+      answered.insert(answered.end(), starved.begin(), starved.end());
+      starved.clear();
+    }
+  };
+
+  // Serve connections with an epoll readiness loop
+  void epoll_loop(session_t& session, int listening_socket)
+  {
+    //--------------------------------------------------------------------------
+    // Setup event loop: listener, channel responses and one entry per client
+    //--------------------------------------------------------------------------
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+      REPORT_FATAL("Could not create epoll instance: " << strerror(errno));
+    }
+    watch(epoll_fd, EPOLL_CTL_ADD, listening_socket, EPOLLIN, LISTENER_KEY);
+    watch(epoll_fd, EPOLL_CTL_ADD, session.channel.pull_fd(), EPOLLIN, CHANNEL_KEY);
+
+    typedef session_t::connection_map connection_map;
+    connection_map& connections(session.connections);
+
+    // Register epoll interest matching the connection's state. Reading stops
+    // while not admitting; EPOLLOUT only while responses are backed up.
+    auto rearm = [&](uint64_t key, connection_t& client) {
+      uint32_t events = EPOLLRDHUP;
+      if (session.admitting(client))     events |= EPOLLIN;
+      if (not client.writer.empty())     events |= EPOLLOUT;
+      if (events != client.events) {
+        watch(epoll_fd, EPOLL_CTL_MOD, client.socket, events, key);
+        client.events = events;
+      }
+    };
+
+    auto disconnect = [&](connection_map::iterator found) {
+      REPORT_NOTE("Connection " << found->first << " closed");
+      close(found->second.socket); //< also removes it from epoll
+      connections.erase(found);    //< responses still in SystemC will be dropped
+    };
+
+    //--------------------------------------------------------------------------
+    //
+    //  #     # 
+    //  ##   ##     #     ###  #    #      #      ####    ####   ##### 
+    //  # # # #    # #     #   ##   #      #     #    #  #    #  #    #
+    //  #  #  #   #   #    #   # #  #      #     #    #  #    #  #    #
+    //  #     #  #######   #   #  # #      #     #    #  #    #  ##### 
+    //  #     #  #     #   #   #   ##      #     #    #  #    #  #     
+    //  #     #  #     #  ###  #    #      #####  ####    ####   #                        
+    //
+    //--------------------------------------------------------------------------
+    // Begin receiving and transmitting data. Every pass through the loop gives
+    // each readable connection at most one recv. A connection is not read again
+    // while the window of its requests are inside SystemC, which keeps any single
+    // client from monopolizing the channel.
+    //--------------------------------------------------------------------------
+    REPORT_INFO("Waiting for incoming connections...");
+    while (session.running) {
+
+      epoll_event events[MAX_EPOLL_EVENTS];
+      int ready = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, 0);
+      if ( ready == 0
+       and not busy_poll(session.poll, session.stats, [&]{
+             return (ready = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, 0)) != 0;
+           })
+      ) {
+        session.stats.slept.fetch_add(1, memory_order_relaxed);
+        ready = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, -1);
+      }
+      if (ready < 0) {
+        if (errno == EINTR) continue;
+        REPORT_FATAL("epoll_wait failed: " << strerror(errno));
+      }
+
+      for (int e=0; session.running and e!=ready; ++e) {
+        uint64_t key = events[e].data.u64;
+
+        //----------------------------------------------------------------------
+        // Accept incoming connections
+        //----------------------------------------------------------------------
+        if (key == LISTENER_KEY) {
+          for(;;) {
+            struct sockaddr_storage remote_client{};
+            socklen_t addr_len = sizeof(remote_client);
+            int incoming_socket = accept4( listening_socket
+                                         , (struct sockaddr *)&remote_client
+                                         , &addr_len
+                                         , SOCK_NONBLOCK
+                                         );
+            if (incoming_socket < 0) {
+              if (errno != EAGAIN and errno != EWOULDBLOCK and errno != EINTR) {
+                REPORT_ERROR("Accept failed: " << strerror(errno));
+              }
+              break;
+            }
+            uint64_t id = session.next_id++;
+            connection_t& client(connections.emplace(id, connection_t(incoming_socket, session.window)).first->second);
+            client.events = EPOLLIN|EPOLLRDHUP;
+            watch(epoll_fd, EPOLL_CTL_ADD, incoming_socket, client.events, id);
+            REPORT_NOTE("Connection " << id << " accepted from " << peer_name(remote_client));
+          }//endforever
+          continue;
+        }//endif
+
+        //----------------------------------------------------------------------
+        // Pull responses from SystemC and queue them on their connections, then
+        // send each connection's responses with one sendmsg.
+        //----------------------------------------------------------------------
+        if (key == CHANNEL_KEY) {
+          uint64_t signalled;
+          while (read(session.channel.pull_fd(), &signalled, sizeof(signalled)) > 0) {}
+          session.collect();
+          for (uint64_t id : session.answered) {
+            auto owner = connections.find(id);
+            if (owner == connections.end()) continue; //< listed twice and already dropped
+            if (owner->second.writer.flush(owner->second.socket) < 0) {
+              report_send_failure(errno);
+              disconnect(owner);
+              continue;
+            }
+            session.dispatch(id, owner->second); //< frames may already be buffered
+            rearm(id, owner->second);
+          }//endfor
+          continue;
+        }//endif
+
+        auto found = connections.find(key);
+        if (found == connections.end()) continue; //< closed earlier this pass
+        connection_t& client(found->second);
+
+        //----------------------------------------------------------------------
+        // Send responses that did not fit in the socket earlier
+        //----------------------------------------------------------------------
+        if (events[e].events & EPOLLOUT) {
+          if (client.writer.flush(client.socket) < 0) {
+            report_send_failure(errno);
+            disconnect(found);
+            continue;
+          }
+        }
+
+        //----------------------------------------------------------------------
+        // Get data from a client. One recv may bring several frames or part of
+        // one; the reader keeps whatever is not yet complete.
+        //----------------------------------------------------------------------
+        if (events[e].events & (EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR)) {
+          int recv_count = client.reader.fill(client.socket);
+          if (recv_count < 0 and (errno == EAGAIN or errno == EINTR or errno == ENOBUFS)) {
+            // nothing to do now
+          } else if (recv_count <= 0) {
+            if (recv_count < 0) {
+              REPORT_ERROR("TCPIP read/recv failed" << strerror(errno));
+            }
+            disconnect(found);
+            continue;
+          } else {
+            REPORT_TRACE("Received " << recv_count << " bytes...");
+          }
+        }
+
+        session.dispatch(key, client);
+        if (client.reader.corrupt()) {
+          REPORT_ERROR("Malformed frame from connection " << key);
+          disconnect(found);
+          continue;
+        }
+        if (not client.writer.empty() and client.writer.flush(client.socket) < 0) { //< debug reads served directly
+          report_send_failure(errno);
+          disconnect(found);
+          continue;
+        }
+        rearm(key, client);
+      }//endfor
+    }//endwhile
+    close(epoll_fd);
+  }//end epoll_loop()
+
+#ifdef HAVE_LIBURING
+  //////////////////////////////////////////////////////////////////////////////
+  // io_uring engine. Accepts and receives are multishot, so one submission
+  // keeps delivering until cancelled. Receives land in a ring of buffers
+  // registered with the kernel (provided buffers), so no buffer is named per
+  // recv. Every pass of the loop submits whatever was queued and waits for
+  // completions in the same io_uring_submit_and_wait call, hence with pipelined
+  // traffic from many clients one system call covers many transactions.
+  //////////////////////////////////////////////////////////////////////////////
+  const unsigned URING_ENTRIES     = 256;
+  const unsigned URING_BUFFERS     = 256;       //< provided receive buffers (power of two)
+  const unsigned URING_BUFFER_SIZE = 16*1024;
+  const int      URING_GROUP       = 0;
+
+  // Completion routing: operation in the top byte, epoll-style key below
+  enum uring_op_t : uint64_t { URING_ACCEPT=1, URING_CHANNEL, URING_RECV, URING_SEND, URING_CANCEL };
+  uint64_t uring_data(uring_op_t op, uint64_t key) { return (uint64_t(op) << 56) | key; }
+  uring_op_t uring_op(uint64_t data) { return uring_op_t(data >> 56); }
+  uint64_t uring_key(uint64_t data) { return data & ((uint64_t(1) << 56) - 1); }
+
+  // Per-connection state only the io_uring engine needs
+  struct uring_connection_t {
+    bool receiving{false};  //< multishot recv armed
+    bool cancelling{false}; //< cancel of the recv requested
+    bool sending{false};    //< send outstanding (one at a time keeps order)
+    bool closing{false};    //< shut down; erased once nothing is outstanding
+    struct held_t { uint16_t buffer; uint32_t offset; uint32_t size; };
+    std::deque<held_t> held; //< received bytes not yet taken by the reader
+  };
+
+  // Returns false if io_uring cannot be set up so the caller can use epoll
+  bool uring_loop(session_t& session, int listening_socket)
+  {
+    io_uring ring;
+    int status = io_uring_queue_init(URING_ENTRIES, &ring, 0);
+    if (status < 0) {
+      REPORT_WARNING("io_uring unavailable (" << strerror(-status) << ") - using epoll");
+      return false;
+    }
+    std::unique_ptr<char[]> buffer_memory(new char[size_t(URING_BUFFERS)*URING_BUFFER_SIZE]);
+    io_uring_buf_ring* buffers = io_uring_setup_buf_ring(&ring, URING_BUFFERS, URING_GROUP, 0, &status);
+    if (buffers == nullptr) {
+      REPORT_WARNING("io_uring provided buffers unavailable (" << strerror(-status) << ") - using epoll");
+      io_uring_queue_exit(&ring);
+      return false;
+    }
+    auto recycle = [&](uint16_t buffer) {
+      io_uring_buf_ring_add( buffers, &buffer_memory[size_t(buffer)*URING_BUFFER_SIZE], URING_BUFFER_SIZE
+                           , buffer, io_uring_buf_ring_mask(URING_BUFFERS), 0);
+      io_uring_buf_ring_advance(buffers, 1);
+    };
+    for (unsigned b=0; b!=URING_BUFFERS; ++b) recycle(uint16_t(b));
+
+    // io_uring completes operations on O_NONBLOCK files with -EAGAIN instead
+    // of waiting, so sockets here are left blocking
+    fcntl(listening_socket, F_SETFL, fcntl(listening_socket, F_GETFL) & ~O_NONBLOCK);
+
+    map<uint64_t,uring_connection_t> state;
+    vector<uint64_t>                 touched; //< connections to service after this batch
+
+    // Next submission entry; if the queue is full submit what is there first
+    auto next_sqe = [&](void) {
+      io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+      if (sqe == nullptr) {
+        io_uring_submit(&ring);
+        sqe = io_uring_get_sqe(&ring);
+      }
+      return sqe;
+    };
+    auto arm_accept = [&](void) {
+      io_uring_sqe* sqe = next_sqe();
+      io_uring_prep_multishot_accept(sqe, listening_socket, nullptr, nullptr, 0);
+      io_uring_sqe_set_data64(sqe, uring_data(URING_ACCEPT, LISTENER_KEY));
+    };
+    auto arm_channel = [&](void) {
+      io_uring_sqe* sqe = next_sqe();
+      io_uring_prep_poll_multishot(sqe, session.channel.pull_fd(), POLLIN);
+      io_uring_sqe_set_data64(sqe, uring_data(URING_CHANNEL, CHANNEL_KEY));
+    };
+    auto arm_recv = [&](uint64_t key, connection_t& client) {
+      io_uring_sqe* sqe = next_sqe();
+      io_uring_prep_recv_multishot(sqe, client.socket, nullptr, 0, 0);
+      sqe->flags    |= IOSQE_BUFFER_SELECT;
+      sqe->buf_group = URING_GROUP;
+      io_uring_sqe_set_data64(sqe, uring_data(URING_RECV, key));
+    };
+    auto cancel_recv = [&](uint64_t key) {
+      io_uring_sqe* sqe = next_sqe();
+      io_uring_prep_cancel64(sqe, uring_data(URING_RECV, key), 0);
+      io_uring_sqe_set_data64(sqe, uring_data(URING_CANCEL, key));
+    };
+    auto send = [&](uint64_t key, connection_t& client) {
+      iovec iov[2];
+      if (client.writer.gather(iov) == 0) return false;
+      io_uring_sqe* sqe = next_sqe();
+      io_uring_prep_send(sqe, client.socket, iov[0].iov_base, iov[0].iov_len, MSG_NOSIGNAL);
+      io_uring_sqe_set_data64(sqe, uring_data(URING_SEND, key));
+      return true;
+    };
+    // Move held receive data into the reader as space allows
+    auto drain = [&](connection_t& client, uring_connection_t& conn) {
+      while (not conn.held.empty()) {
+        uring_connection_t::held_t& front(conn.held.front());
+        size_t taken = client.reader.append(&buffer_memory[size_t(front.buffer)*URING_BUFFER_SIZE + front.offset], front.size);
+        front.offset += taken;
+        front.size   -= taken;
+        if (front.size != 0) break; //< reader full
+        recycle(front.buffer);
+        conn.held.pop_front();
+      }
+    };
+    auto disconnect = [&](uint64_t key, connection_t& client, uring_connection_t& conn) {
+      if (conn.closing) return;
+      REPORT_NOTE("Connection " << key << " closed");
+      shutdown(client.socket, SHUT_RDWR); //< completes outstanding operations
+      conn.closing = true;
+    };
+
+    arm_accept();
+    arm_channel();
+    REPORT_INFO("Waiting for incoming connections (io_uring)...");
+    while (session.running) {
+      if (io_uring_cq_ready(&ring) == 0) {
+        if (session.poll.count() != 0) io_uring_submit(&ring); //< start pending I/O before polling
+        if (not busy_poll(session.poll, session.stats, [&]{ return io_uring_cq_ready(&ring) != 0; })) {
+          session.stats.slept.fetch_add(1, memory_order_relaxed);
+        }
+      }
+      status = io_uring_submit_and_wait(&ring, 1);
+      if (status < 0 and status != -EINTR) {
+        REPORT_FATAL("io_uring_submit_and_wait failed: " << strerror(-status));
+      }
+
+      //------------------------------------------------------------------------
+      // Record completions; connections are serviced once afterwards
+      //------------------------------------------------------------------------
+      touched.clear();
+      io_uring_cqe* cqe;
+      unsigned      head;
+      unsigned      seen{0};
+      io_uring_for_each_cqe(&ring, head, cqe) {
+        ++seen;
+        uint64_t data = io_uring_cqe_get_data64(cqe);
+        uint64_t key  = uring_key(data);
+        bool     more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+        switch (uring_op(data)) {
+          case URING_ACCEPT:
+            {
+            if (cqe->res >= 0) {
+              uint64_t id = session.next_id++;
+              connection_t& client(session.connections.emplace(id, connection_t(cqe->res, session.window)).first->second);
+              state[id].receiving = true;
+              arm_recv(id, client);
+              REPORT_NOTE("Connection " << id << " accepted");
+            } else if (cqe->res != -EINTR) {
+              REPORT_ERROR("Accept failed: " << strerror(-cqe->res));
+            }
+            if (not more) arm_accept();
+            break;
+            }
+          case URING_CHANNEL:
+            {
+            uint64_t signalled;
+            while (read(session.channel.pull_fd(), &signalled, sizeof(signalled)) > 0) {}
+            if (not more) arm_channel();
+            session.collect();
+            touched.insert(touched.end(), session.answered.begin(), session.answered.end());
+            break;
+            }
+          case URING_RECV:
+            {
+            auto found = session.connections.find(key);
+            if (found == session.connections.end()) { //< cannot happen while state holds it
+              if (cqe->flags & IORING_CQE_F_BUFFER) recycle(uint16_t(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+              break;
+            }
+            uring_connection_t& conn(state[key]);
+            if (cqe->res > 0) {
+              conn.held.push_back({uint16_t(cqe->flags >> IORING_CQE_BUFFER_SHIFT), 0, uint32_t(cqe->res)});
+              drain(found->second, conn);
+            } else if (cqe->flags & IORING_CQE_F_BUFFER) {
+              recycle(uint16_t(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+            if (cqe->res == 0 or (cqe->res < 0 and cqe->res != -ENOBUFS and cqe->res != -ECANCELED)) {
+              if (cqe->res < 0) REPORT_ERROR("TCPIP read/recv failed" << strerror(-cqe->res));
+              disconnect(key, found->second, conn);
+            }
+            if (not more) {
+              conn.receiving  = false; //< rearmed below if still wanted
+              conn.cancelling = false;
+            }
+            touched.push_back(key);
+            break;
+            }
+          case URING_SEND:
+            {
+            auto found = session.connections.find(key);
+            if (found == session.connections.end()) break;
+            uring_connection_t& conn(state[key]);
+            conn.sending = false;
+            if (cqe->res < 0) {
+              report_send_failure(-cqe->res);
+              disconnect(key, found->second, conn);
+            } else {
+              found->second.writer.sent(size_t(cqe->res));
+            }
+            touched.push_back(key);
+            break;
+            }
+          default: //< URING_CANCEL
+            break;
+        }//endswitch
+      }
+      io_uring_cq_advance(&ring, seen);
+
+      //------------------------------------------------------------------------
+      // Service each touched connection: dispatch requests, start the next
+      // send, and keep a recv armed only while the connection is admitting
+      //------------------------------------------------------------------------
+      for (uint64_t key : touched) {
+        auto found = session.connections.find(key);
+        if (found == session.connections.end()) continue; //< listed twice and already erased
+        connection_t&       client(found->second);
+        uring_connection_t& conn(state[key]);
+        if (not conn.closing) {
+          size_t before;
+          do { //< dispatching frees reader space for held data
+            before = conn.held.size();
+            session.dispatch(key, client);
+            drain(client, conn);
+          } while (session.running and conn.held.size() != before);
+          if (client.reader.corrupt()) {
+            REPORT_ERROR("Malformed frame from connection " << key);
+            disconnect(key, client, conn);
+          }
+        }
+        if (not conn.closing) {
+          if (not conn.sending) conn.sending = send(key, client);
+          bool wanted = session.admitting(client) and conn.held.empty();
+          if (wanted and not conn.receiving) {
+            arm_recv(key, client);
+            conn.receiving = true;
+          } else if (not wanted and conn.receiving and not conn.cancelling) {
+            cancel_recv(key);
+            conn.cancelling = true;
+          }
+        } else if (not conn.sending and not conn.receiving) {
+          for (auto& held : conn.held) recycle(held.buffer);
+          close(client.socket);
+          session.connections.erase(found); //< responses still in SystemC will be dropped
+          state.erase(key);
+        }
+      }//endfor
+    }//endwhile
+
+    io_uring_free_buf_ring(&ring, buffers, URING_BUFFERS, URING_GROUP);
+    io_uring_queue_exit(&ring);
+    return true;
+  }//end uring_loop()
+#endif
 }
 
-int async_adaptor_module::s_stop_requests{0};
+int async_adaptor_module::s_signal_pipe[2]{-1,-1};
 
 ///////////////////////////////////////////////////////////////////////////////
 // Constructor <<
 async_adaptor_module::async_adaptor_module(sc_module_name instance_name)
 : sc_module(instance_name)
 , initiator_socket("initiator_socket")
+, debug_port("debug_port")
 , m_async_channel("m_async_channel")
-, m_keep_alive_signal("m_keep_alive_signal")
 , m_tcpip_port(4000)
+, m_window(16)
+, m_uring(false)
+, m_pool_size(256)
+, m_to_sysc_high(m_async_channel.capacity())
+, m_to_sysc_low(m_async_channel.capacity()/2)
+, m_fm_sysc_high(m_async_channel.capacity())
+, m_fm_sysc_low(m_async_channel.capacity()/2)
+, m_poll_us(0)
+, m_os_cpu(-1)
+, m_sysc_cpu(-1)
+, m_rt_priority(0)
+, m_quantum(SC_ZERO_TIME)
+, m_start_time(SC_ZERO_TIME)
+, m_dmi(true)
+, m_bus_bytes(initiator_socket.get_bus_width()/8)
+, m_debug(nullptr)
+, m_posted(false)
 , m_lock_permission(new std::lock_guard<std::mutex>(m_allow_pthread))
 , m_pthread(&async_adaptor_module::async_os_thread,this,std::ref(m_async_channel))
 {
-  signal(SIGINT,&async_adaptor_module::sighandler); //< allow for graceful interrupts
+  // Allow for graceful interrupts
+  if (pipe2(s_signal_pipe, O_CLOEXEC) < 0) {
+    REPORT_FATAL("Unable to create signal pipe: " << strerror(errno));
+  }
+  fcntl(s_signal_pipe[1], F_SETFL, O_NONBLOCK); //< the handler must never block
+  m_signal_thread = std::thread(&async_adaptor_module::signal_thread, this);
+  signal(SIGINT,&async_adaptor_module::sighandler);
+  m_lane_weight[TLMX_LANE_URGENT] = 16;
+  m_lane_weight[TLMX_LANE_NORMAL] = 4;
+  m_lane_weight[TLMX_LANE_BULK]   = 1;
 
   //----------------------------------------------------------------------------
   // Parse command-line arguments
   //----------------------------------------------------------------------------
+  // HIGH[,LOW] with LOW defaulting to half of HIGH
+  auto parse_watermarks = [](const string& value, size_t& high, size_t& low) {
+    high = max(1,atoi(value.c_str()));
+    size_t comma = value.find(',');
+    low  = (comma == string::npos) ? high/2 : size_t(max(0,atoi(value.substr(comma+1).c_str())));
+  };
   for (int i=1; i<sc_argc(); ++i) {
     string arg(sc_argv()[i]);
     if      (arg.find("-debug")  == 0) sc_report_handler::set_verbosity_level(SC_DEBUG);
@@ -97,27 +891,114 @@ async_adaptor_module::async_adaptor_module(sc_module_name instance_name)
     else if (arg.find("-full")   == 0) sc_report_handler::set_verbosity_level(SC_FULL);
     else if (arg.find("-port=")  == 0) {
       m_tcpip_port = atoi(arg.substr(6).c_str());
+    }
+    else if (arg.find("-poll=")  == 0) {
+      m_poll_us = max(0,atoi(arg.substr(6).c_str()));
+    }
+    else if (arg.find("-cpu=")   == 0) {
+      m_os_cpu = atoi(arg.substr(5).c_str());
+    }
+    else if (arg.find("-sysc_cpu=") == 0) {
+      m_sysc_cpu = atoi(arg.substr(10).c_str());
+    }
+    else if (arg.find("-rt=")    == 0) {
+      m_rt_priority = max(0,atoi(arg.substr(4).c_str()));
+    }
+    else if (arg.find("-posted") == 0) {
+      m_posted = true;
+    }
+    else if (arg.find("-nodmi")  == 0) {
+      m_dmi = false;
+    }
+    else if (arg.find("-quantum=") == 0) {
+      m_quantum = sc_time(max(0,atoi(arg.substr(9).c_str())), SC_NS);
+    }
+    else if (arg.find("-socket=") == 0) {
+      m_socket_path = arg.substr(8);
+    }
+    else if (arg.find("-shm=") == 0) {
+      m_shm_name = arg.substr(5);
+    }
+    else if (arg.find("-uring")  == 0) {
+#ifdef HAVE_LIBURING
+      m_uring = true;
+#else
+      REPORT_WARNING("Built without liburing (HAVE_LIBURING) - using epoll");
+#endif
+    }
+    else if (arg.find("-window=") == 0) {
+      m_window = max(1,atoi(arg.substr(8).c_str()));
+      if (m_window > TLMX_MAX_WINDOW) {
+        REPORT_WARNING("-window limited to " << TLMX_MAX_WINDOW << " (TLMX_MAX_WINDOW)");
+        m_window = TLMX_MAX_WINDOW;
+      }
+    }
+    else if (arg.find("-to_sysc=") == 0) {
+      parse_watermarks(arg.substr(9), m_to_sysc_high, m_to_sysc_low);
+    }
+    else if (arg.find("-fm_sysc=") == 0) {
+      parse_watermarks(arg.substr(9), m_fm_sysc_high, m_fm_sysc_low);
+    }
+    else if (arg.find("-lanes=") == 0) {
+      if (arg.substr(7) == "strict") {
+        fill(begin(m_lane_weight), end(m_lane_weight), 0u);
+      } else {
+        istringstream weights(arg.substr(7));
+        char comma;
+        weights >> m_lane_weight[TLMX_LANE_URGENT] >> comma >> m_lane_weight[TLMX_LANE_NORMAL] >> comma >> m_lane_weight[TLMX_LANE_BULK];
+      }
+    }
+    else if (arg.find("-pool=")  == 0) {
+      m_pool_size = max(1,atoi(arg.substr(6).c_str()));
+      if (size_t(m_pool_size) > m_async_channel.capacity()) {
+        REPORT_WARNING("Pool limited to channel capacity of " << m_async_channel.capacity());
+        m_pool_size = m_async_channel.capacity();
+      }
     }//endif
   }//endfor
+  tlm_utils::tlm_quantumkeeper::set_global_quantum(m_quantum);
+  m_async_channel.set_to_sysc_watermarks(m_to_sysc_high, m_to_sysc_low);
+  m_async_channel.set_fm_sysc_watermarks(m_fm_sysc_high, m_fm_sysc_low);
+  m_async_channel.set_lane_weights(m_lane_weight[TLMX_LANE_URGENT], m_lane_weight[TLMX_LANE_NORMAL], m_lane_weight[TLMX_LANE_BULK]);
 
   //----------------------------------------------------------------------------
   // Report configuration
   //----------------------------------------------------------------------------
   REPORT_INFO("\n===================================================================================\n"
            << "CONFIGURATION\n"
-           << ">   Listening on port " << m_tcpip_port << "\n"
+           << ">   Listening on " << ( not m_shm_name.empty()    ? "shared memory " + m_shm_name
+                                   : not m_socket_path.empty() ? m_socket_path
+                                   : "port " + to_string(m_tcpip_port)
+                                   ) << "\n"
+           << ">   Up to " << m_window << " requests outstanding per connection\n"
+           << ">   Up to " << m_pool_size << " requests inside SystemC in total\n"
+           << ">   Reading stops at " << m_async_channel.to_sysc_high() << " queued requests, resumes at " << m_async_channel.to_sysc_low() << "\n"
+           << ">   Responses wait at " << m_async_channel.fm_sysc_high() << " queued, resume at " << m_async_channel.fm_sysc_low() << "\n"
+           << ">   Request lanes (urgent:normal:bulk) "
+           << (m_lane_weight[TLMX_LANE_URGENT] == 0 and m_lane_weight[TLMX_LANE_NORMAL] == 0 and m_lane_weight[TLMX_LANE_BULK] == 0
+               ? string("in strict priority")
+               : "weighted " + to_string(m_lane_weight[TLMX_LANE_URGENT]) + ":" + to_string(m_lane_weight[TLMX_LANE_NORMAL])
+                 + ":" + to_string(m_lane_weight[TLMX_LANE_BULK])) << "\n"
+           << ">   Socket I/O via " << (m_uring ? "io_uring" : "epoll") << "\n"
+           << ">   Busy-poll " << m_poll_us << " us before blocking\n"
+           << ">   Writes are " << (m_posted ? "posted (acknowledged when queued)" : "acknowledged when performed") << "\n"
+           << ">   DMI " << (m_dmi ? "used when granted" : "disabled") << "\n"
+           << ">   Global quantum " << m_quantum << (m_quantum == SC_ZERO_TIME ? " (synchronize every activation)" : "") << "\n"
+           << ">   OS thread on CPU " << (m_os_cpu < 0 ? string("any") : to_string(m_os_cpu))
+           << (m_rt_priority > 0 ? ", SCHED_FIFO priority " + to_string(m_rt_priority) : string())
+           << "; SystemC thread on CPU " << (m_sysc_cpu < 0 ? string("any") : to_string(m_sysc_cpu)) << "\n"
            << ">   Verbosity is " << sc_report_handler::get_verbosity_level() << "\n"
            << "===================================================================================\n"
            );
 
-  // Register TLM backwards path methods -NONE-
+  // Register TLM backwards path methods
+  initiator_socket.register_invalidate_direct_mem_ptr(this, &async_adaptor_module::invalidate_direct_mem_ptr);
 
   //----------------------------------------------------------------------------
   // Register processes
   //----------------------------------------------------------------------------
   SC_HAS_PROCESS(async_adaptor_module);
   SC_THREAD(initiator_sysc_thread_process);
-  SC_THREAD(keep_alive_process);
   REPORT_INFO("Constructed " << name());
 }//endconstructor
 
@@ -125,6 +1006,12 @@ async_adaptor_module::async_adaptor_module(sc_module_name instance_name)
 // Destructor <<
 async_adaptor_module::~async_adaptor_module(void)
 {
+  signal(SIGINT,SIG_DFL);
+  char quit = 0;
+  if (write(s_signal_pipe[1], &quit, 1) == 1) m_signal_thread.join();
+  else                                        m_signal_thread.detach();
+  close(s_signal_pipe[0]);
+  close(s_signal_pipe[1]);
   REPORT_INFO("Destroyed " << name());
 }
 
@@ -138,17 +1025,23 @@ void async_adaptor_module::before_end_of_elaboration(void)
 void async_adaptor_module::end_of_elaboration(void)
 {
   REPORT_INFO(__func__ << " " << name());
+  m_debug = (debug_port.size() != 0) ? debug_port[0] : nullptr;
 }
 
 void async_adaptor_module::start_of_simulation(void) {
   REPORT_INFO(__func__ << " " << name());
-  m_keep_alive_signal.write(true);
+  place_thread("SystemC thread", m_sysc_cpu, 0);
   m_lock_permission.reset(nullptr);
 }
 
 void async_adaptor_module::end_of_simulation(void)
 {
   REPORT_INFO(__func__ << " " << name());
+  REPORT_INFO("OS thread handled " << m_os_stats.requests.load() << " requests; "
+           << m_os_stats.polled.load() << " waits ended while busy-polling, "
+           << m_os_stats.slept.load() << " blocked in the kernel");
+  REPORT_INFO("SystemC initiator " << m_sysc_stats.polled.load() << " waits ended while busy-polling, "
+           << m_sysc_stats.slept.load() << " suspended");
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -156,42 +1049,74 @@ void async_adaptor_module::end_of_simulation(void)
 void async_adaptor_module::async_os_thread(tlmx_channel& async_channel) {
   REPORT_INFO("Starting " << __func__ << " ...");
 
+  { // wait for systemc to release (also ensures command-line options are parsed)
+    std::lock_guard<std::mutex> request_permission(m_allow_pthread);
+  }
+  place_thread("OS thread", m_os_cpu, m_rt_priority);
+
+  // Every packet sent to SystemC comes from here
+  tlmx_packet_pool pool(m_pool_size);
+
+  // Same-host shared memory replaces the sockets entirely
+  if (not m_shm_name.empty()) {
+    async_shm_thread(async_channel, pool);
+    async_channel.request_stop();
+    return;
+  }
+
   //----------------------------------------------------------------------------
-  // Open TCP/IP socket to async_adaptor
+  // Open TCP/IP (or, for same-host clients, AF_UNIX) socket to async_adaptor
   //----------------------------------------------------------------------------
   struct sockaddr_in local_server;
+  struct sockaddr_un local_unix;
+  struct sockaddr*   local_address     = (struct sockaddr *)&local_server;
+  socklen_t          local_address_len = sizeof(local_server);
   int option_value;
 
+  if (not m_socket_path.empty()) {
+    if (m_socket_path.size() >= sizeof(local_unix.sun_path)) {
+      REPORT_FATAL("Socket path too long: " << m_socket_path);
+    }
+    bzero(&local_unix,sizeof(local_unix));
+    local_unix.sun_family = AF_UNIX;
+    strcpy(local_unix.sun_path, m_socket_path.c_str());
+    local_address     = (struct sockaddr *)&local_unix;
+    local_address_len = sizeof(local_unix);
+    unlink(local_unix.sun_path); //< left over from an earlier run
+  }
+
   // Create socket
-  int listening_socket = socket(AF_INET, SOCK_STREAM, 0);
+  int listening_socket = socket(local_address->sa_family, SOCK_STREAM|SOCK_NONBLOCK, 0);
   if (listening_socket == -1) {
     REPORT_FATAL("Could not create socket");
   }
 
-  // Prepare the sockaddr_in structure
-  local_server.sin_family = AF_INET;
-  local_server.sin_addr.s_addr = INADDR_ANY;
-  local_server.sin_port = htons( m_tcpip_port );
+  if (m_socket_path.empty()) {
+    // Prepare the sockaddr_in structure
+    local_server.sin_family = AF_INET;
+    local_server.sin_addr.s_addr = INADDR_ANY;
+    local_server.sin_port = htons( m_tcpip_port );
 
-  option_value = 1;
-  if ( setsockopt
-       ( listening_socket
-       , SOL_SOCKET
-       , SO_REUSEADDR
-       , (void* )&option_value
-       , (socklen_t)(sizeof(socklen_t))
-       ) < 0
-  ) {
-    REPORT_FATAL("Unable to set socket option");
-  }
+    option_value = 1;
+    if ( setsockopt
+         ( listening_socket
+         , SOL_SOCKET
+         , SO_REUSEADDR
+         , (void* )&option_value
+         , (socklen_t)(sizeof(socklen_t))
+         ) < 0
+    ) {
+      REPORT_FATAL("Unable to set socket option");
+    }
+  }//endif
    
   //----------------------------------------------------------------------------
   // Bind socket in preparation to listening
   //----------------------------------------------------------------------------
   if ( bind
        ( listening_socket
-       , (struct sockaddr *)&local_server 
-       , sizeof(local_server)
+       , local_address
+       , local_address_len
        ) < 0
   ) {
     REPORT_FATAL("Bind failed");
@@ -203,201 +1128,232 @@ void async_adaptor_module::async_os_thread(tlmx_channel& async_channel) {
   // Listen for requests to connect
   //----------------------------------------------------------------------------
   REPORT_INFO("Queueing incoming connections...");
-  listen(listening_socket, 1 /*request at a time*/);
-
-  { // wait for systemc to release
-    std::lock_guard<std::mutex> request_permission(m_allow_pthread);
-  }
-
-  // Holding place for data
-  uint8_t data_ptr[TLMX_MAX_DATA_LEN];
-  int     incoming_socket{0};
+  listen(listening_socket, SOMAXCONN);
 
   //----------------------------------------------------------------------------
-  // Watch for traffic
+  // Serve clients until TLMX_EXIT
   //----------------------------------------------------------------------------
-  REPORT_INFO("Waiting for incoming connections...");
-  // Accept an incoming connection
-  int addr_len = sizeof(struct sockaddr_in);
-  struct sockaddr_in remote_client;
-  incoming_socket = accept( listening_socket
-                          , (struct sockaddr *)&remote_client
-                          , (socklen_t*)&addr_len
-                          );
-  if (incoming_socket<0) {
-    REPORT_FATAL("Accept failed: " << strerror(errno));
-  }
-  REPORT_NOTE("Connection accepted...");
+  session_t session(async_channel, pool, m_window, chrono::microseconds(m_poll_us), m_os_stats, m_debug, m_posted);
+  bool      served{false};
+#ifdef HAVE_LIBURING
+  if (m_uring) served = uring_loop(session, listening_socket); //< false if io_uring unavailable
+#endif
+  if (not served) epoll_loop(session, listening_socket);
 
-  //----------------------------------------------------------------------------
-  //
-  //  #     # 
-  //  ##   ##     #     ###  #    #      #      ####    ####   ##### 
-  //  # # # #    # #     #   ##   #      #     #    #  #    #  #    #
-  //  #  #  #   #   #    #   # #  #      #     #    #  #    #  #    #
-  //  #     #  #######   #   #  # #      #     #    #  #    #  ##### 
-  //  #     #  #     #   #   #   ##      #     #    #  #    #  #     
-  //  #     #  #     #  ###  #    #      #####  ####    ####   #                        
-  //
-  //----------------------------------------------------------------------------
-  // Begin receiving and transmitting data
-  //----------------------------------------------------------------------------
-  for(;;) {
+  REPORT_INFO("Closing down...");
 
-    //--------------------------------------------------------------------------
-    // Get data
-    //--------------------------------------------------------------------------
-    char receive_buffer[TLMX_MAX_BUFFER];
-    bzero(receive_buffer,TLMX_MAX_BUFFER);
-    int recv_count = read(incoming_socket, receive_buffer, TLMX_MAX_BUFFER);
-    if(recv_count < 0) {
-      REPORT_ERROR("TCPIP read/recv failed" << strerror(errno));
-    }
-    if (recv_count < TLMX_DATA_PTR_INDEX) {
-      REPORT_FATAL("Incomplete packet received");
-    }
-    REPORT_NOTE("Received data...");
+  // Close TCP/IP sockets to async_adaptor
+  for (auto& client : session.connections) close(client.second.socket);
+  close(listening_socket);
+  if (not m_socket_path.empty()) unlink(m_socket_path.c_str());
+  async_channel.request_stop();
 
-    //--------------------------------------------------------------------------
-    // Unpack data
-    //--------------------------------------------------------------------------
-    bzero(data_ptr,TLMX_MAX_DATA_LEN); //< clear to aid debugging
-    tlmx_packet_ptr tlmx_trans_ptr(new tlmx_packet( TLMX_IGNORE, 0, 0, data_ptr ));
-    int unpacked_size = tlmx_trans_ptr->unpack(receive_buffer);
-    REPORT_NOTE("Request to SystemC " << tlmx_trans_ptr->str());
-
-    // Exit if commanded
-    if (tlmx_trans_ptr->command == TLMX_EXIT) {
-      REPORT_NOTE("Exiting due to TLMX_EXIT...");
-      break;
-    }
+}//end async_adaptor_module::async_os_thread()
 
-    //--------------------------------------------------------------------------
-    // Send request to SystemC
-    //--------------------------------------------------------------------------
-    REPORT_NOTE("Pushing to async_channel...");
-    async_channel.push(tlmx_trans_ptr);
+// Serve a single same-host driver through the ring pair of tlmx_shm.h. There
+// are no system calls while traffic flows: requests are taken from to_sysc as
+// they appear and responses are written to fm_sysc as SystemC returns them.
+// When idle the thread sleeps on a futex (nothing in SystemC) or on the
+// channel's pull_fd (waiting for SystemC, rechecking the ring every
+// millisecond so that requests pipelined meanwhile are not held back).
+void async_adaptor_module::async_shm_thread(tlmx_channel& async_channel, tlmx_packet_pool& pool) {
+  tlmx_shm_t* shm = tlmx_shm_create(m_shm_name.c_str());
+  if (shm == nullptr) {
+    REPORT_FATAL("Unable to create shared memory " << m_shm_name << ": " << strerror(errno));
+  }
+  REPORT_NOTE("Serving shared memory " << m_shm_name);
+  tlmx_shm_ring_t* requests  = &shm->to_sysc;
+  tlmx_shm_ring_t* responses = &shm->fm_sysc;
 
-    //--------------------------------------------------------------------------
-    // Wait for channel to pass payload to initiator_sysc_thread_process & return results
-    // from TLM 2.0 transport.
-    //--------------------------------------------------------------------------
-    REPORT_NOTE("Waiting for async_channel ...");
-    async_channel.wait_for_put();
-    // ASSERTION: Should be ready
+  char                        scratch[TLMX_MAX_FRAME];
+  char                        response[TLMX_MAX_FRAME];
+  int                         outstanding{0}; //< requests inside SystemC
+  tlmx_lane_t                 lane{TLMX_LANE_NORMAL}; //< of those requests
+  posting_t                   posting;
+  bool                        running{true};
 
-    //--------------------------------------------------------------------------
-    // Pull response from SystemC
-    //--------------------------------------------------------------------------
-    REPORT_NOTE("Pulling from async_channel ...");
-    if (not async_channel.nb_pull(tlmx_trans_ptr)) {
-      REPORT_FATAL("Missing response");
-    }
-    REPORT_NOTE("Response from SystemC " << tlmx_trans_ptr->str());
-    // Check for errors and adjust
-    if (tlmx_trans_ptr->status != TLMX_OK_RESPONSE) {
-      REPORT_ERROR(tlmx_status_to_str(tlmx_status_t(tlmx_trans_ptr->status)));
-    }
+  while (running) {
+    bool progress{false};
 
-    //--------------------------------------------------------------------------
-    // Pack data
-    //--------------------------------------------------------------------------
-    char transmit_buffer[TLMX_MAX_BUFFER];
-    bzero(transmit_buffer,TLMX_MAX_BUFFER);
-    int packed_size = tlmx_trans_ptr->pack(transmit_buffer);
-    sc_assert(packed_size == unpacked_size);
+    // Admit requests while the window has room and the response ring is
+    // guaranteed to hold the answer to everything inside SystemC
+    int   frame_size{0};
+    char* frame;
+    while ( outstanding < m_window
+        and pool.available() != 0
+        and async_channel.can_push()
+        and tlmx_shm_ring_space(responses) >= size_t(outstanding+1)*TLMX_MAX_FRAME
+        and (frame = tlmx_shm_ring_peek(requests, scratch, &frame_size)) != nullptr
+    ) {
+      progress = true;
+      tlmx_packet_pool::slot_t* slot = pool.acquire();
+      slot->tag = tlmx_frame_tag(frame);
+      tlmx_packet_ptr& tlmx_trans_ptr(slot->packet);
+      tlmx_trans_ptr->unpack(frame + TLMX_FRAME_HEADER_SIZE);
+      tlmx_shm_ring_consume(requests, frame_size);
+      REPORT_TRACE("Request to SystemC tag " << slot->tag << " " << tlmx_trans_ptr->str());
 
-    //--------------------------------------------------------------------------
-    // Send response to TCP/IP
-    //--------------------------------------------------------------------------
-    REPORT_NOTE("Sending response ...");
-    int send_count = write(incoming_socket, transmit_buffer, packed_size);
-    if(send_count < 0) {
-      REPORT_ERROR("TCPIP write/send failed" << strerror(errno));
+      // Exit if commanded
+      if (tlmx_trans_ptr->command == TLMX_EXIT) {
+        REPORT_NOTE("Exiting due to TLMX_EXIT...");
+        pool.release(slot);
+        running = false;
+        break;
+      }
+
+      // Posted writes are answered at once, and so are debug reads when
+      // nothing is inside SystemC for them to overtake
+      bool direct = (outstanding == 0 and serve_debug_read(m_debug, *tlmx_trans_ptr));
+      slot->posted = not direct and posting.post(*tlmx_trans_ptr, m_posted);
+      if (direct or slot->posted) {
+        int packed_size = tlmx_trans_ptr->pack(response + TLMX_FRAME_HEADER_SIZE);
+        tlmx_frame_set_header(response, packed_size, slot->tag);
+        int put_status = tlmx_shm_ring_put(responses, response, TLMX_FRAME_HEADER_SIZE + packed_size);
+        sc_assert(put_status == 0); //< guaranteed by admission above
+        if (direct) {
+          pool.release(slot);
+          continue;
+        }
+      }
+
+      // Same lane while anything is inside SystemC, to keep the order
+      if (outstanding == 0) lane = tlmx_lane_of(*tlmx_trans_ptr);
+      ++outstanding;
+      m_os_stats.requests.fetch_add(1, memory_order_relaxed);
+      async_channel.push(tlmx_trans_ptr, lane);
+    }//endwhile
+    if (frame_size < 0) {
+      REPORT_FATAL("Malformed request frame in shared memory " << m_shm_name);
     }
-    sc_assert(send_count == packed_size);
-  }//endforever
 
-  REPORT_INFO("Closing down...");
+    // Return responses
+    uint64_t signalled;
+    while (read(async_channel.pull_fd(), &signalled, sizeof(signalled)) > 0) {}
+    tlmx_packet_ptr tlmx_trans_ptr;
+    while (async_channel.nb_pull(tlmx_trans_ptr)) {
+      progress = true;
+      tlmx_packet_pool::slot_t* slot = pool.find(*tlmx_trans_ptr);
+      if (slot == nullptr) {
+        REPORT_ERROR("Response without matching request " << tlmx_trans_ptr->str());
+        continue;
+      }
+      if (posting.settle(*tlmx_trans_ptr, slot->posted)) {
+        if (tlmx_trans_ptr->status != TLMX_OK_RESPONSE) {
+          REPORT_ERROR(tlmx_status_to_str(tlmx_status_t(tlmx_trans_ptr->status)));
+        }
+        int packed_size = tlmx_trans_ptr->pack(response + TLMX_FRAME_HEADER_SIZE);
+        tlmx_frame_set_header(response, packed_size, slot->tag);
+        int put_status = tlmx_shm_ring_put(responses, response, TLMX_FRAME_HEADER_SIZE + packed_size);
+        sc_assert(put_status == 0); //< guaranteed by admission above
+      }
+      pool.release(slot);
+      --outstanding;
+    }//endwhile
+    if (progress or not running) continue;
 
-  // Close TCP/IP socket to async_adaptor
-  close(incoming_socket);
+    // Idle
+    if (busy_poll(chrono::microseconds(m_poll_us), m_os_stats, [&]{
+          return not tlmx_shm_ring_empty(requests) or async_channel.can_pull();
+        })
+    ) {
+      continue;
+    }
+    m_os_stats.slept.fetch_add(1, memory_order_relaxed);
+    if (outstanding == 0) {
+      tlmx_shm_ring_wait_data(requests);
+    } else {
+      pollfd channel = { async_channel.pull_fd(), POLLIN, 0 };
+      (void)poll(&channel, 1, 1);
+    }
+  }//endwhile
 
-}//end async_adaptor_module::async_os_thread()
+  munmap(shm, sizeof(tlmx_shm_t));
+  shm_unlink(m_shm_name.c_str());
+}//end async_adaptor_module::async_shm_thread()
 
 ///////////////////////////////////////////////////////////////////////////////
 // Processes <<
 void async_adaptor_module::initiator_sysc_thread_process(void)  {
   REPORT_INFO("Started " << __func__ << " " << name());
 
-  // Holding place for data
-  uint8_t data_ptr[TLMX_MAX_DATA_LEN];
+  // Requests arrive in packets owned by the OS thread's pool
+  tlmx_packet_ptr tlmx_trans_ptr{0};
+  vector<tlmx_packet_ptr> responses;
+  responses.reserve(m_async_channel.capacity());
   tlm::tlm_generic_payload tlm2_trans;
   sc_time delay(SC_ZERO_TIME);
+  tlm_utils::tlm_quantumkeeper quantum_keeper; //< local time ahead of sc_time_stamp()
+
+  // Resume the clock of a restored checkpoint; requests queue up meanwhile
+  if (m_start_time > sc_time_stamp()) {
+    wait(m_start_time - sc_time_stamp());
+    REPORT_INFO("Serving requests from " << sc_time_stamp());
+  }
+  quantum_keeper.reset(); //< quantum boundary from the resumed time, not 0
 
   for(;;) {
-    // Wait for data to arrive from remote
-    m_keep_alive_signal.write(true); //< this could be removed iff we know for a certainty there is other traffic/computations
-    wait(m_async_channel.sysc_put_event());
-    REPORT_NOTE("Received sysc_put_event");
-    m_keep_alive_signal.write(false);
-
-    // Setup place to receive incoming payload
-    bzero(data_ptr,TLMX_MAX_DATA_LEN); //< clear to aid debugging
-    tlmx_packet_ptr tlmx_trans_ptr(new tlmx_packet( TLMX_IGNORE, 0, 0, data_ptr ));
-
-    // Lockdown and obtain from incoming queue
-    if (not m_async_channel.nb_get(tlmx_trans_ptr)) {
-      REPORT_ERROR("Missing response");
-    }
-
-    // Setup TLM 2.0 generic payload
-    tlm2_trans.set_address         ( tlmx_trans_ptr->address         );
-    tlm2_trans.set_data_ptr        ( tlmx_trans_ptr->data_ptr        );
-    tlm2_trans.set_data_length     ( tlmx_trans_ptr->data_len        );
-    tlm2_trans.set_streaming_width ( tlmx_trans_ptr->data_len        );
-    tlm2_trans.set_byte_enable_ptr ( nullptr                      );
-    tlm2_trans.set_dmi_allowed     ( false                        );
-    tlm2_trans.set_response_status ( tlm::TLM_INCOMPLETE_RESPONSE );
-    switch(tlmx_trans_ptr->command) {
-      case      TLMX_IGNORE: tlm2_trans.set_command(tlm::TLM_IGNORE_COMMAND);        break;
-      case       TLMX_WRITE: tlm2_trans.set_command(tlm::TLM_READ_COMMAND);          break;
-      case TLMX_DEBUG_WRITE: tlm2_trans.set_command(tlm::TLM_WRITE_COMMAND);         break;
-      case        TLMX_READ: tlm2_trans.set_command(tlm::TLM_READ_COMMAND);          break;
-      case  TLMX_DEBUG_READ: tlm2_trans.set_command(tlm::TLM_READ_COMMAND);          break;
-      default              : REPORT_WARNING("Unknown TLMX command - ignored");  break;
-    }//endswitch
-    
-    // Initiate appropriate transport
-    int transferred(0);
-    switch(tlmx_trans_ptr->command) {
-      case TLMX_DEBUG_READ:
-      case TLMX_DEBUG_WRITE:
-        {
-        transferred = initiator_socket->transport_dbg(tlm2_trans);
-        if (transferred != tlmx_trans_ptr->data_len) REPORT_WARNING("transport_dbg returned " << transferred);
-        // TODO: add this to tlmx_packet information
-        break;
-        }
-      default :
-        {
-        delay = SC_ZERO_TIME;
-        initiator_socket->b_transport(tlm2_trans,delay);
-        wait(delay);
-        break;
-        }
-    }//endswitch
+    // Wait for data to arrive from remote. The channel keeps the kernel
+    // suspended, using no CPU, until then. Local time is synchronized first
+    // so the rest of the design catches up before the initiator goes idle.
+    if (not m_async_channel.can_put()) {
+      wait(m_async_channel.sysc_get_event()); //< the OS thread is behind on responses
+      REPORT_TRACE("Received sysc_get_event");
+      continue;
+    }
+    if (not m_async_channel.can_get()) {
+      if (quantum_keeper.get_local_time() != SC_ZERO_TIME) {
+        quantum_keeper.sync();
+        continue;
+      }
+      if (m_async_channel.stop_requested()) break;
+      // With -poll the hand-off is watched for the same window as the OS
+      // thread's, so a request arriving soon is taken without the kernel
+      // suspending and being woken again
+      if (busy_poll(chrono::microseconds(m_poll_us), m_sysc_stats, [&]{
+            return m_async_channel.can_get() or m_async_channel.stop_requested();
+          })
+      ) {
+        continue;
+      }
+      m_sysc_stats.slept.fetch_add(1, memory_order_relaxed);
+      wait(m_async_channel.sysc_put_event() | m_async_channel.sysc_stop_event());
+      REPORT_TRACE("Received sysc_put_event");
+      continue;
+    }
 
-    // Update tlmx_packet
-    switch (tlm2_trans.get_response_status()) {
-      case               tlm::TLM_OK_RESPONSE: tlmx_trans_ptr->status = TLMX_OK_RESPONSE;            break;
-      case    tlm::TLM_ADDRESS_ERROR_RESPONSE: tlmx_trans_ptr->status = TLMX_ADDRESS_ERROR_RESPONSE; break;
-      case       tlm::TLM_INCOMPLETE_RESPONSE: tlmx_trans_ptr->status = TLMX_INCOMPLETE_RESPONSE;    break;
-      default                                : tlmx_trans_ptr->status = TLMX_GENERIC_ERROR_RESPONSE; break;
-    }//endswitch
+    // Drain the incoming queue. Requests that arrived together are performed
+    // back to back, like the operations of a batch, annotating local time.
+    // With no quantum that is synchronized once per drain; otherwise only when
+    // the quantum is used up, and responses leave without waiting for it.
+    bool timed{false};
+    delay = quantum_keeper.get_local_time();
+    responses.clear();
+    while (responses.size() != responses.capacity() and m_async_channel.nb_get(tlmx_trans_ptr)) {
+      tlmx_command_t command = tlmx_command_t(tlmx_trans_ptr->command);
+      if (command == TLMX_FENCE) {
+        tlmx_trans_ptr->status = TLMX_OK_RESPONSE; //< in order, so all before it is done
+      } else if (command == TLMX_BATCH) {
+        tlmx_trans_ptr->status = transport_batch(tlm2_trans, *tlmx_trans_ptr, delay);
+      } else {
+        tlmx_trans_ptr->status = transport
+          ( tlm2_trans
+          , command
+          , tlmx_trans_ptr->address
+          , tlmx_trans_ptr->data_ptr
+          , tlmx_trans_ptr->data_len
+          , delay
+          );
+      }//endif
+      timed |= (command != TLMX_DEBUG_READ and command != TLMX_DEBUG_WRITE and command != TLMX_FENCE);
+      responses.push_back(tlmx_trans_ptr);
+    }//endwhile
+    quantum_keeper.set(delay);
+    if (timed and quantum_keeper.need_sync()) {
+      quantum_keeper.sync();
+    }
 
-    // Lockdown and place in outgoing queue
-    m_async_channel.nb_put(tlmx_trans_ptr);
+    // Place all in outgoing queue with a single notification
+    m_async_channel.nb_put(responses);
 
   }//endforever
   wait(1,SC_SEC);
@@ -405,28 +1361,222 @@ void async_adaptor_module::initiator_sysc_thread_process(void)  {
   sc_stop();
 }//end async_adaptor_module::initiator_sysc_thread_process()
 
-// In the event there is nothing else happening, this process will keep the
-// simulator from starving.
-void async_adaptor_module::keep_alive_process(void)  {
-  REPORT_INFO("Started " << __func__ << " " << name());
-  for(;;) {
-    if ( s_stop_requests > 0 ) break;
-    if (!m_keep_alive_signal.read()) {
-      wait(m_keep_alive_signal.default_event());
-    }
-    wait(SC_ZERO_TIME);
-  }//endforever
-  wait(1,SC_SEC);
-  REPORT_INFO("Exiting due to stop request.");
-  sc_stop();
-}//end async_adaptor_module::keep_alive_process()
+///////////////////////////////////////////////////////////////////////////////
+// TLM-2 backward methods
+
+// The target revoked direct access; forget every region overlapping the range
+void async_adaptor_module::invalidate_direct_mem_ptr(uint64 start_range, uint64 end_range)
+{
+  auto first = m_dmi_regions.upper_bound(start_range);
+  if (first != m_dmi_regions.begin() and prev(first)->second.get_end_address() >= start_range) --first;
+  m_dmi_regions.erase(first, m_dmi_regions.upper_bound(end_range));
+  REPORT_NOTE("DMI invalidated 0x" << hex << start_range << "..0x" << end_range);
+}
 
+// Only async-signal-safe calls are allowed here, hence the pipe
 void async_adaptor_module::sighandler(int sig)
 {
-  ++s_stop_requests;
+  char stop = 1;
+  ssize_t ignored = write(s_signal_pipe[1], &stop, 1);
+  (void)ignored;
+}
+
+// Turns SIGINT into a stop request; a zero byte from the destructor ends it.
+// The default action is restored after the first SIGINT so that a second one
+// still terminates a simulation that does not stop.
+void async_adaptor_module::signal_thread(void)
+{
+  char byte;
+  while (read(s_signal_pipe[0], &byte, 1) == 1 and byte != 0) {
+    REPORT_INFO("Exiting due to stop request.");
+    signal(SIGINT,SIG_DFL);
+    m_async_channel.request_stop();
+  }//endwhile
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Helper methods -NONE-
+// Helper methods
+
+// Perform a single TLMX operation as a TLM 2.0 transaction. Timed transports
+// add to delay without waiting so callers may issue several back to back.
+tlmx_status_t async_adaptor_module::transport
+( tlm::tlm_generic_payload& tlm2_trans
+, tlmx_command_t            command
+, uint64                    address
+, uint8_t*                  data_ptr
+, unsigned int              data_len
+, sc_time&                  delay
+)
+{
+  bool debug = (command == TLMX_DEBUG_READ  or command == TLMX_DEBUG_WRITE);
+  bool write = (command == TLMX_WRITE       or command == TLMX_DEBUG_WRITE);
+  bool plain = (command == TLMX_READ        or command == TLMX_WRITE or debug);
+
+  // Whole-word accesses to a region the target granted DMI for go straight to
+  // its storage, still charging the latency it quoted per bus value
+  if ( plain
+   and data_len != 0
+   and address  % m_bus_bytes == 0
+   and data_len % m_bus_bytes == 0
+  ) {
+    if (const tlm::tlm_dmi* dmi = find_dmi(address, data_len, write)) {
+      unsigned char* storage = dmi->get_dmi_ptr() + (address - dmi->get_start_address());
+      if (write) {
+        if (m_debug) m_debug->async_debug_lock().write_begin(); //< debug reads may be copying
+        memcpy(storage, data_ptr, data_len);
+        if (m_debug) m_debug->async_debug_lock().write_end();
+      } else {
+        memcpy(data_ptr, storage, data_len);
+      }
+      if (not debug) {
+        delay += (write ? dmi->get_write_latency() : dmi->get_read_latency()) * (data_len/m_bus_bytes);
+      }
+      return TLMX_OK_RESPONSE;
+    }
+  }//endif
+
+  // Setup TLM 2.0 generic payload
+  tlm2_trans.set_address         ( address                      );
+  tlm2_trans.set_data_ptr        ( data_ptr                     );
+  tlm2_trans.set_data_length     ( data_len                     );
+  tlm2_trans.set_streaming_width ( data_len                     );
+  tlm2_trans.set_byte_enable_ptr ( nullptr                      );
+  tlm2_trans.set_dmi_allowed     ( false                        );
+  tlm2_trans.set_response_status ( tlm::TLM_INCOMPLETE_RESPONSE );
+  switch(command) {
+    case      TLMX_IGNORE: tlm2_trans.set_command(tlm::TLM_IGNORE_COMMAND);        break;
+    case       TLMX_WRITE: tlm2_trans.set_command(tlm::TLM_WRITE_COMMAND);         break;
+    case TLMX_DEBUG_WRITE: tlm2_trans.set_command(tlm::TLM_WRITE_COMMAND);         break;
+    case        TLMX_READ: tlm2_trans.set_command(tlm::TLM_READ_COMMAND);          break;
+    case  TLMX_DEBUG_READ: tlm2_trans.set_command(tlm::TLM_READ_COMMAND);          break;
+    default              : REPORT_WARNING("Unknown TLMX command - ignored");
+                           tlm2_trans.set_command(tlm::TLM_IGNORE_COMMAND);        break;
+  }//endswitch
+
+  switch(command) {
+    case TLMX_DEBUG_READ:
+    case TLMX_DEBUG_WRITE:
+      {
+      int transferred = initiator_socket->transport_dbg(tlm2_trans);
+      if (transferred != int(data_len)) REPORT_WARNING("transport_dbg returned " << transferred);
+      // TODO: add this to tlmx_packet information
+      break;
+      }
+    default :
+      {
+      initiator_socket->b_transport(tlm2_trans,delay);
+      // Ask for direct access the first time the target offers it
+      if ( m_dmi
+       and plain
+       and tlm2_trans.is_dmi_allowed()
+       and tlm2_trans.is_response_ok()
+       and find_dmi(address, 1, write) == nullptr
+      ) {
+        tlm::tlm_dmi dmi;
+        if (initiator_socket->get_direct_mem_ptr(tlm2_trans, dmi)) {
+          add_dmi(dmi);
+          REPORT_NOTE("DMI granted 0x" << hex << dmi.get_start_address() << "..0x" << dmi.get_end_address());
+        }
+      }
+      break;
+      }
+  }//endswitch
+
+  // Convert response
+  switch (tlm2_trans.get_response_status()) {
+    case               tlm::TLM_OK_RESPONSE: return TLMX_OK_RESPONSE;
+    case    tlm::TLM_ADDRESS_ERROR_RESPONSE: return TLMX_ADDRESS_ERROR_RESPONSE;
+    case       tlm::TLM_INCOMPLETE_RESPONSE: return TLMX_INCOMPLETE_RESPONSE;
+    default                                : return TLMX_GENERIC_ERROR_RESPONSE;
+  }//endswitch
+}//end async_adaptor_module::transport()
+
+// Cached DMI region covering all of [address, address+data_len) with the
+// needed access, or nullptr
+// Regions are keyed by start address and disjoint, so the only candidate is
+// the last one starting at or below address. A paged target grants one region
+// per page, which makes this a tree search rather than a scan.
+const tlm::tlm_dmi* async_adaptor_module::find_dmi(uint64 address, unsigned int data_len, bool write) const
+{
+  auto after = m_dmi_regions.upper_bound(address);
+  if (after == m_dmi_regions.begin()) return nullptr;
+  const tlm::tlm_dmi& dmi = prev(after)->second;
+  if ( address + data_len - 1 <= dmi.get_end_address()
+   and (write ? dmi.is_write_allowed() : dmi.is_read_allowed())
+  ) {
+    return &dmi;
+  }
+  return nullptr;
+}//end async_adaptor_module::find_dmi()
+
+// Keep m_dmi_regions disjoint: a new grant replaces any it overlaps, and
+// joins a neighbour whose storage and terms continue it. Each grant costs
+// O(log n) however many pages a scan touches.
+void async_adaptor_module::add_dmi(const tlm::tlm_dmi& dmi)
+{
+  auto joins = [](const tlm::tlm_dmi& lower, const tlm::tlm_dmi& upper) {
+    return lower.get_end_address() + 1 == upper.get_start_address()
+       and lower.get_dmi_ptr() + (lower.get_end_address() - lower.get_start_address() + 1) == upper.get_dmi_ptr()
+       and lower.get_granted_access() == upper.get_granted_access()
+       and lower.get_read_latency()   == upper.get_read_latency()
+       and lower.get_write_latency()  == upper.get_write_latency();
+  };
+  auto first = m_dmi_regions.upper_bound(dmi.get_start_address());
+  if (first != m_dmi_regions.begin() and prev(first)->second.get_end_address() >= dmi.get_start_address()) --first;
+  auto next = m_dmi_regions.erase(first, m_dmi_regions.upper_bound(dmi.get_end_address()));
+  tlm::tlm_dmi merged(dmi);
+  if (next != m_dmi_regions.end() and joins(merged, next->second)) {
+    merged.set_end_address(next->second.get_end_address());
+    next = m_dmi_regions.erase(next);
+  }
+  if (next != m_dmi_regions.begin() and joins(prev(next)->second, merged)) {
+    prev(next)->second.set_end_address(merged.get_end_address());
+    return;
+  }
+  m_dmi_regions.emplace_hint(next, merged.get_start_address(), merged);
+}//end async_adaptor_module::add_dmi()
+
+// Perform the operations of a TLMX_BATCH in order, recording each status (and
+// any read data) in place. Returns TLMX_OK_RESPONSE only if all succeeded,
+// otherwise the first failing status.
+tlmx_status_t async_adaptor_module::transport_batch
+( tlm::tlm_generic_payload& tlm2_trans
+, tlmx_packet&              batch
+, sc_time&                  delay
+)
+{
+  tlmx_status_t result{TLMX_OK_RESPONSE};
+  char*         op  = reinterpret_cast<char*>(batch.data_ptr);
+  char*         end = op + batch.data_len;
+  uint64        count{0};
+  while ( op + TLMX_BATCH_OP_HEADER_SIZE <= end
+      and op + tlmx_batch_op_size(op)    <= end
+  ) {
+    tlmx_command_t command = tlmx_batch_command(op);
+    tlmx_status_t  status;
+    if (command == TLMX_BATCH or command == TLMX_EXIT) {
+      REPORT_WARNING("Illegal command inside TLMX_BATCH - ignored");
+      status = TLMX_GENERIC_ERROR_RESPONSE;
+    } else {
+      status = transport
+        ( tlm2_trans
+        , command
+        , tlmx_batch_address(op)
+        , reinterpret_cast<uint8_t*>(op + TLMX_BATCH_OP_HEADER_SIZE)
+        , tlmx_batch_data_len(op)
+        , delay
+        );
+    }//endif
+    tlmx_batch_set_status(op, status);
+    if (status != TLMX_OK_RESPONSE and result == TLMX_OK_RESPONSE) result = status;
+    op += tlmx_batch_op_size(op);
+    ++count;
+  }//endwhile
+  if (op != end or count != batch.address) {
+    REPORT_ERROR("Malformed TLMX_BATCH: decoded " << count << " of " << batch.address << " operations");
+    result = TLMX_GENERIC_ERROR_RESPONSE;
+  }
+  return result;
+}//end async_adaptor_module::transport_batch()
 
 //EOF
@@ -20,24 +20,40 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "tlmx_channel.h"
+#include "tlmx_pool.h"
+#include "async_debug_if.h"
 #include "tlm_utils/simple_initiator_socket.h"
 #include <systemc>
+#include <atomic>
+#include <map>
+#include <vector>
 #include <thread>
 #include <mutex>
 
+// Activity of the adaptor's OS thread, reported at end of simulation. Written
+// only by that thread; atomic so SystemC may read it while the thread runs.
+struct async_os_stats_t
+{
+  std::atomic<uint64_t> requests{0}; //< packets pushed into SystemC
+  std::atomic<uint64_t> polled{0};   //< waits that found work while busy-polling
+  std::atomic<uint64_t> slept{0};    //< waits that blocked in the kernel
+};
+
 struct async_adaptor_module
 : sc_core::sc_module
 {
 public:
   // Ports
   tlm_utils::simple_initiator_socket<async_adaptor_module> initiator_socket;
+  sc_core::sc_port<async_debug_if,1,sc_core::SC_ZERO_OR_MORE_BOUND> debug_port; //< optional; serves TLMX_DEBUG_READ off the scheduler
   // Channels
   tlmx_channel             m_async_channel;
-  sc_core::sc_signal<bool> m_keep_alive_signal;
   // Constructor
   async_adaptor_module(sc_core::sc_module_name instance_name);
   // Destructor
   virtual ~async_adaptor_module(void);
+  // Serve no requests before this time, e.g. that of a restored checkpoint
+  void set_start_time(const sc_core::sc_time& start) { m_start_time = start; }
   // SC_MODULE callbacks
   void before_end_of_elaboration(void) override;
   void end_of_elaboration(void) override;
@@ -45,19 +61,61 @@ public:
   void end_of_simulation(void) override;
   // SystemC processes
   void initiator_sysc_thread_process(void);
-  void keep_alive_process(void);
+  // TLM-2 backward methods
+  void invalidate_direct_mem_ptr(sc_dt::uint64 start_range, sc_dt::uint64 end_range);
 private:
   // External OS thread
   void async_os_thread(tlmx_channel& channel);
-  // Signal handler
+  void async_shm_thread(tlmx_channel& channel, tlmx_packet_pool& pool);
+  // Signal handling: the handler only writes to s_signal_pipe; the signal
+  // thread reads it and asks the channel to stop SystemC
   typedef void (*sig_t) (int);
   static void sighandler(int sig);
+  void signal_thread(void);
+  // Helper methods
+  tlmx_status_t transport
+  ( tlm::tlm_generic_payload& tlm2_trans
+  , tlmx_command_t            command
+  , sc_dt::uint64             address
+  , uint8_t*                  data_ptr
+  , unsigned int              data_len
+  , sc_core::sc_time&         delay
+  );
+  const tlm::tlm_dmi* find_dmi(sc_dt::uint64 address, unsigned int data_len, bool write) const;
+  void add_dmi(const tlm::tlm_dmi& dmi);
+  tlmx_status_t transport_batch
+  ( tlm::tlm_generic_payload& tlm2_trans
+  , tlmx_packet&              batch
+  , sc_core::sc_time&         delay
+  );
   // Module attributes/local data
   int          m_tcpip_port;
+  std::string  m_socket_path; //< AF_UNIX path; empty for TCP/IP on m_tcpip_port
+  std::string  m_shm_name;    //< shared memory segment; replaces sockets if set
+  int          m_window;      //< max requests outstanding per connection
+  bool         m_uring;       //< socket I/O through io_uring (needs HAVE_LIBURING)
+  int          m_pool_size;   //< packets available to carry requests into SystemC
+  size_t       m_to_sysc_high, m_to_sysc_low; //< request queue watermarks as given (-to_sysc=)
+  size_t       m_fm_sysc_high, m_fm_sysc_low; //< response queue watermarks as given (-fm_sysc=)
+  unsigned     m_lane_weight[TLMX_LANES];     //< all 0 for strict priority (-lanes=)
+  int          m_poll_us;     //< OS thread and initiator busy-poll this long before blocking (0 = never)
+  int          m_os_cpu;      //< core for the OS thread (-1 = any)
+  int          m_sysc_cpu;    //< core for the SystemC thread (-1 = any)
+  int          m_rt_priority; //< SCHED_FIFO priority for the OS thread (0 = normal)
+  sc_core::sc_time m_quantum; //< global quantum for temporal decoupling (0 = none)
+  sc_core::sc_time m_start_time; //< see set_start_time
+  bool         m_dmi;         //< use DMI when the target grants it
+  unsigned int m_bus_bytes;   //< initiator_socket width
+  std::map<sc_dt::uint64, tlm::tlm_dmi> m_dmi_regions; //< granted by the target, until invalidated; by start address, disjoint
+  async_debug_if* m_debug;    //< bound to debug_port, or nullptr
+  bool         m_posted;      //< acknowledge TLMX_WRITE when queued (-posted)
+  async_os_stats_t m_os_stats;
+  async_os_stats_t m_sysc_stats; //< waits of the SystemC initiator (requests unused)
   std::mutex   m_allow_pthread; //< must be declared before m_lock_permission
   std::unique_ptr<std::lock_guard<std::mutex>> m_lock_permission; //< must be declared before m_pthread
   std::thread  m_pthread;
-  static int   s_stop_requests;
+  std::thread  m_signal_thread;
+  static int   s_signal_pipe[2]; //< [0] read by m_signal_thread, [1] written by sighandler
 };
 
 #endif
@@ -0,0 +1,405 @@
+#ifndef ASYNC_CHANNEL_H
+#define ASYNC_CHANNEL_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Generic channel from one OS thread to SystemC and back, carrying values of
+// type T (which may be move-only). As in tlmx_channel, the thread side uses
+// push/pull and the SystemC side put/get, and each side sees only its own
+// interface. The channel keeps the SystemC kernel suspended, rather than
+// starved, while it waits for the thread.
+//
+// Compile-time choices:
+//
+//   Notify  How the thread learns of puts: async_notify_futex (wait_for_put
+//           only) or async_notify_eventfd (also a pull_fd for epoll/io_uring)
+//   ToSysc  Queue from the thread to SystemC
+//   FmSysc  Queue from SystemC to the thread
+//
+// A queue is constructed from a capacity and provides bool push(T&&) (which
+// leaves the value alone when full), bool pop(T&), empty(), size() and
+// capacity(). spsc_ring is the lock-free default for a single OS thread;
+// async_locked_queue lets several OS threads push.
+//
+// Each direction has high and low watermarks: once the producer finds the
+// queue at the high one, can_push()/can_put() stay false until the consumer
+// has brought it down to the low one. Queue depths are reported at the end
+// of simulation.
+
+#include "spsc_ring.h"
+#include "async_completion.h"
+#include <systemc>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define ASYNC_CHANNEL_MSGID "/Doulos/example/async_channel"
+
+// SystemC side
+template<typename T>
+struct basic_async_sysc_if : virtual sc_core::sc_interface
+{
+  virtual bool nb_get(T& value)                               = 0;
+  virtual bool can_get(void) const                            = 0;
+  virtual void get(T& value)                                  = 0;
+  virtual T    get(void)                                      = 0;
+  virtual bool can_put(void)                                  = 0; //< false from the high watermark until back at the low one
+  virtual void nb_put(T value)                                = 0;
+  virtual void nb_put(std::vector<T>& values)                 = 0; //< moves all out with one notification
+  virtual const sc_core::sc_event& default_event(void) const  = 0;
+  virtual const sc_core::sc_event& sysc_put_event(void) const = 0;
+  virtual const sc_core::sc_event& sysc_get_event(void) const = 0;
+  virtual const sc_core::sc_event& sysc_stop_event(void) const = 0;
+  virtual bool stop_requested(void) const                     = 0;
+};
+
+// OS thread side
+template<typename T>
+struct basic_async_thread_if
+{
+  virtual ~basic_async_thread_if(void) {}
+  virtual void push(T value) = 0;
+  virtual bool can_push(void) = 0; //< false from the high watermark until back at the low one
+  virtual bool can_pull(void) const = 0;
+  virtual bool nb_pull(T& value) = 0;
+  // Waiting without missing an event: take the sequence, check for work, and
+  // only then wait for the sequence to move on. The void forms wait for the
+  // next event after the call.
+  virtual uint32_t get_sequence(void) const = 0;
+  virtual uint32_t put_sequence(void) const = 0;
+  virtual void wait_for_get (uint32_t seen) const = 0;
+  virtual void wait_for_put (uint32_t seen) const = 0;
+  virtual void wait_for_get (void) const = 0;
+  virtual void wait_for_put (void) const = 0;
+  virtual int  pull_fd      (void) const = 0; //< readable when nb_pull has data, or -1
+  virtual void request_stop (void) = 0;       //< ask SystemC to finish (from any thread)
+};
+
+//------------------------------------------------------------------------------
+// Notification policies
+
+// Futex only: threads block in wait_for_put()
+struct async_notify_futex
+{
+  uint32_t sequence(void) const { return m_completion.sequence(); }
+  void     signal(void)         { m_completion.signal(); }
+  void     wait(uint32_t seen) const { m_completion.wait(seen); }
+  void     set_spin(unsigned iterations) { m_completion.set_spin(iterations); }
+  int      fd(void) const       { return -1; }
+private:
+  async_completion m_completion;
+};
+
+// Futex and an eventfd that event loops can poll. Reading the eventfd
+// (8 bytes) clears the indication; always drain with nb_pull afterwards.
+struct async_notify_eventfd
+{
+  async_notify_eventfd(void) : m_eventfd(eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC))
+  {
+    if (m_eventfd < 0) {
+      SC_REPORT_FATAL(ASYNC_CHANNEL_MSGID, "Unable to create eventfd");
+    }
+  }
+  ~async_notify_eventfd(void) { close(m_eventfd); }
+  async_notify_eventfd(const async_notify_eventfd&) = delete;
+  async_notify_eventfd& operator=(const async_notify_eventfd&) = delete;
+  uint32_t sequence(void) const { return m_completion.sequence(); }
+  void     signal(void)
+  {
+    uint64_t one = 1;
+    if (write(m_eventfd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      SC_REPORT_ERROR(ASYNC_CHANNEL_MSGID, (std::string("Unable to signal pull_fd: ") + strerror(errno)).c_str());
+    }
+    m_completion.signal();
+  }
+  void     wait(uint32_t seen) const { m_completion.wait(seen); }
+  void     set_spin(unsigned iterations) { m_completion.set_spin(iterations); }
+  int      fd(void) const       { return m_eventfd; }
+private:
+  async_completion m_completion;
+  int              m_eventfd;
+};
+
+//------------------------------------------------------------------------------
+// Bounded queue for several producer threads (and one consumer)
+template<typename T>
+struct async_locked_queue
+{
+  explicit async_locked_queue(size_t capacity) : m_capacity(capacity) {}
+  bool push(T&& value)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_queue.size() == m_capacity) return false;
+    m_queue.push_back(std::move(value));
+    return true;
+  }
+  bool pop(T& value)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_queue.empty()) return false;
+    value = std::move(m_queue.front());
+    m_queue.pop_front();
+    return true;
+  }
+  bool   empty(void) const    { std::lock_guard<std::mutex> lock(m_mutex); return m_queue.empty(); }
+  size_t size(void) const     { std::lock_guard<std::mutex> lock(m_mutex); return m_queue.size(); }
+  size_t capacity(void) const { return m_capacity; }
+private:
+  const size_t       m_capacity;
+  mutable std::mutex m_mutex;
+  std::deque<T>      m_queue;
+};
+
+//------------------------------------------------------------------------------
+// Flow control and occupancy of one direction, kept by its producer(s). With
+// several producers (async_locked_queue) the statistics are approximate.
+struct async_flow
+{
+  size_t                high;
+  size_t                low;
+  std::atomic<bool>     throttled{false};
+  std::atomic<size_t>   peak{0};      //< deepest after a push/put
+  std::atomic<uint64_t> depth_sum{0}; //< depth after each push/put
+  std::atomic<uint64_t> count{0};     //< pushes/puts
+  std::atomic<uint64_t> throttles{0}; //< times the high watermark was reached
+
+  explicit async_flow(size_t capacity) : high(capacity), low(capacity/2) {}
+
+  void set(size_t new_high, size_t new_low, size_t capacity)
+  {
+    high = std::max(size_t(1), std::min(new_high, capacity));
+    low  = std::min(new_low, high-1);
+  }
+
+  // Hysteresis: closed at the high watermark, reopened at the low one
+  bool admit(size_t depth)
+  {
+    if (throttled.load(std::memory_order_relaxed)) {
+      throttled.store(depth > low, std::memory_order_relaxed);
+    } else if (depth >= high) {
+      throttled.store(true, std::memory_order_relaxed);
+      throttles.store(throttles.load(std::memory_order_relaxed)+1, std::memory_order_relaxed);
+    }
+    return not throttled.load(std::memory_order_relaxed);
+  }
+
+  // Plain loads and stores; exact with a single producer
+  void record(size_t depth)
+  {
+    if (depth > peak.load(std::memory_order_relaxed)) peak.store(depth, std::memory_order_relaxed);
+    depth_sum.store(depth_sum.load(std::memory_order_relaxed)+depth, std::memory_order_relaxed);
+    count.store(count.load(std::memory_order_relaxed)+1, std::memory_order_relaxed);
+  }
+
+  void report(const std::string& direction, size_t capacity) const
+  {
+    uint64_t n = count.load(std::memory_order_relaxed);
+    std::ostringstream mout;
+    mout << direction << ": " << n << " packets, depth peak " << peak.load(std::memory_order_relaxed)
+         << " mean " << (n ? double(depth_sum.load(std::memory_order_relaxed))/n : 0.0)
+         << " of " << capacity << "; watermarks " << high << "/" << low
+         << " reached " << throttles.load(std::memory_order_relaxed) << " times";
+    SC_REPORT_INFO(ASYNC_CHANNEL_MSGID, mout.str().c_str());
+  }
+};
+
+//------------------------------------------------------------------------------
+template< typename T
+        , size_t   Capacity
+        , typename Notify = async_notify_eventfd
+        , typename ToSysc = spsc_ring<T>
+        , typename FmSysc = spsc_ring<T>
+        >
+struct async_channel
+: sc_core::sc_prim_channel
+, virtual basic_async_sysc_if<T>
+, virtual basic_async_thread_if<T>
+{
+  explicit async_channel(const char* instance_name = sc_core::sc_gen_unique_name("async_channel"))
+  : sc_core::sc_prim_channel(instance_name)
+  , m_queue_to_sysc(Capacity)
+  , m_queue_fm_sysc(Capacity)
+  , m_to_sysc_flow(m_queue_to_sysc.capacity())
+  , m_fm_sysc_flow(m_queue_fm_sysc.capacity())
+  {
+    this->async_attach_suspending(); //< wait for the thread instead of starving
+  }
+  ~async_channel(void)
+  {
+    this->async_detach_suspending();
+  }
+
+  // Thread side
+  bool can_push(void) override
+  {
+    return m_to_sysc_flow.admit(m_queue_to_sysc.size());
+  }
+  void push(T value) override
+  {
+    // Place in queue; only full if SystemC holds more than capacity() values
+    while (not m_queue_to_sysc.push(std::move(value))) std::this_thread::yield();
+    pushed();
+  }
+  bool can_pull(void) const override
+  {
+    return not m_queue_fm_sysc.empty();
+  }
+  bool nb_pull(T& value) override
+  {
+    if (not m_queue_fm_sysc.pop(value)) return false;
+    // Notify SystemC
+    m_thread_did_pull.store(true, std::memory_order_release);
+    this->async_request_update();
+    return true;
+  }
+  uint32_t get_sequence(void) const override { return m_sysc_got.sequence(); }
+  uint32_t put_sequence(void) const override { return m_sysc_put.sequence(); }
+  void wait_for_get(uint32_t seen) const override { m_sysc_got.wait(seen); }
+  void wait_for_put(uint32_t seen) const override { m_sysc_put.wait(seen); }
+  void wait_for_get(void) const override { m_sysc_got.wait(m_sysc_got.sequence()); }
+  void wait_for_put(void) const override { m_sysc_put.wait(m_sysc_put.sequence()); }
+  int  pull_fd(void) const override { return m_sysc_put.fd(); }
+  // Safe from any OS thread (but not a signal handler)
+  void request_stop(void) override
+  {
+    m_stop_requested.store(true, std::memory_order_release);
+    m_thread_did_stop.store(true, std::memory_order_release);
+    this->async_request_update();
+  }
+
+  // SystemC side
+  bool can_get(void) const override
+  {
+    return not m_queue_to_sysc.empty();
+  }
+  bool nb_get(T& value) override
+  {
+    if (not m_queue_to_sysc.pop(value)) return false;
+    // Release waiting threads
+    m_sysc_got.signal();
+    return true;
+  }
+  void get(T& value) override
+  {
+    while (not nb_get(value)) sc_core::wait(m_sysc_put_event);
+  }
+  T    get(void) override
+  {
+    T value{};
+    get(value);
+    return value;
+  }
+  bool can_put(void) override
+  {
+    return m_fm_sysc_flow.admit(m_queue_fm_sysc.size());
+  }
+  void nb_put(T value) override
+  {
+    put_one(value);
+    m_sysc_put.signal();
+  }
+  // A burst costs the thread a single wake-up
+  void nb_put(std::vector<T>& values) override
+  {
+    if (values.empty()) return;
+    for (T& value : values) put_one(value);
+    values.clear();
+    m_sysc_put.signal();
+  }
+  const sc_core::sc_event& default_event(void) const override { return m_sysc_put_event; }
+  const sc_core::sc_event& sysc_put_event(void) const override { return m_sysc_put_event; }
+  const sc_core::sc_event& sysc_get_event(void) const override { return m_sysc_get_event; }
+  const sc_core::sc_event& sysc_stop_event(void) const override { return m_sysc_stop_event; }
+  bool stop_requested(void) const override { return m_stop_requested.load(std::memory_order_acquire); }
+
+  // Configuration
+  size_t capacity(void) const { return m_queue_fm_sysc.capacity(); } //< per direction
+  void   set_spin(unsigned iterations) //< polls before wait_for_* sleeps
+  {
+    m_sysc_got.set_spin(iterations);
+    m_sysc_put.set_spin(iterations);
+  }
+  // Defaults are capacity() and half of it; low is clamped to below high
+  void   set_to_sysc_watermarks(size_t high, size_t low) { m_to_sysc_flow.set(high, low, m_queue_to_sysc.capacity()); }
+  void   set_fm_sysc_watermarks(size_t high, size_t low) { m_fm_sysc_flow.set(high, low, m_queue_fm_sysc.capacity()); }
+  // Watermarks in effect, after set_*_watermarks clamped them
+  size_t to_sysc_high(void) const { return m_to_sysc_flow.high; }
+  size_t to_sysc_low (void) const { return m_to_sysc_flow.low;  }
+  size_t fm_sysc_high(void) const { return m_fm_sysc_flow.high; }
+  size_t fm_sysc_low (void) const { return m_fm_sysc_flow.low;  }
+
+  void update(void) override
+  {
+    // Flags are cleared before notifying; a push or pull racing with this
+    // sets its flag again and requests another update of its own
+    if (m_thread_did_push.exchange(false, std::memory_order_acq_rel)) {
+      m_sysc_put_event.notify(sc_core::SC_ZERO_TIME);
+    }
+    if (m_thread_did_pull.exchange(false, std::memory_order_acq_rel)) {
+      m_sysc_get_event.notify(sc_core::SC_ZERO_TIME);
+    }
+    if (m_thread_did_stop.exchange(false, std::memory_order_acq_rel)) {
+      m_sysc_stop_event.notify(sc_core::SC_ZERO_TIME);
+    }
+  }
+  void end_of_simulation(void) override
+  {
+    m_to_sysc_flow.report(std::string(this->name()) + " to SystemC", m_queue_to_sysc.capacity());
+    m_fm_sysc_flow.report(std::string(this->name()) + " from SystemC", m_queue_fm_sysc.capacity());
+  }
+
+protected:
+  // For pushes straight into m_queue_to_sysc by derived channels
+  void pushed(void)
+  {
+    m_to_sysc_flow.record(m_queue_to_sysc.size());
+    m_thread_did_push.store(true, std::memory_order_release);
+    this->async_request_update();
+  }
+  ToSysc m_queue_to_sysc; //< data from thread
+  FmSysc m_queue_fm_sysc; //< data from systemc
+
+private:
+  void put_one(T& value)
+  {
+    // Push onto queue; only full if the thread stopped pulling
+    while (not m_queue_fm_sysc.push(std::move(value))) std::this_thread::yield();
+    m_fm_sysc_flow.record(m_queue_fm_sysc.size());
+  }
+  async_flow               m_to_sysc_flow;          //< owned by the thread
+  async_flow               m_fm_sysc_flow;          //< owned by SystemC
+  std::atomic<bool>        m_thread_did_push{false}; //< indicates push to m_queue_to_sysc
+  std::atomic<bool>        m_thread_did_pull{false}; //< indicates pull from m_queue_fm_sysc
+  std::atomic<bool>        m_thread_did_stop{false}; //< indicates request_stop
+  std::atomic<bool>        m_stop_requested{false};  //< latched by request_stop
+  sc_core::sc_event        m_sysc_put_event;  //< indicates thread put
+  sc_core::sc_event        m_sysc_get_event;  //< indicates thread pull
+  sc_core::sc_event        m_sysc_stop_event; //< indicates thread request_stop
+  async_completion         m_sysc_got;        //< signalled by nb_get
+  Notify                   m_sysc_put;        //< signalled by nb_put
+};
+
+#endif /*ASYNC_CHANNEL_H*/
@@ -0,0 +1,67 @@
+// FILE: async_completion.cpp
+
+////////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "async_completion.h"
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+  // The futex word is the counter itself (std::atomic<uint32_t> is a plain
+  // 32-bit word on Linux)
+  uint32_t* futex_word(const std::atomic<uint32_t>& counter)
+  {
+    return reinterpret_cast<uint32_t*>(const_cast<std::atomic<uint32_t>*>(&counter));
+  }
+  inline void cpu_relax(void)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+}
+
+void async_completion::signal(void)
+{
+  // Advancing the sequence and checking for sleepers are both sequentially
+  // consistent, as are the waiter's registration and recheck in wait(), so
+  // at least one side sees the other
+  m_sequence.fetch_add(1, std::memory_order_seq_cst);
+  if (m_sleepers.load(std::memory_order_seq_cst) != 0) {
+    syscall(SYS_futex, futex_word(m_sequence), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+  }
+}
+
+void async_completion::wait(uint32_t seen) const
+{
+  for (unsigned i=0; i!=m_spin; ++i) {
+    if (m_sequence.load(std::memory_order_acquire) != seen) return;
+    cpu_relax();
+  }
+  m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+  while (m_sequence.load(std::memory_order_seq_cst) == seen) {
+    // Returns at once if the sequence already moved (EAGAIN) or on EINTR
+    syscall(SYS_futex, futex_word(m_sequence), FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr, 0);
+  }
+  m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+//EOF
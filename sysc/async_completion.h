@@ -0,0 +1,44 @@
+#ifndef ASYNC_COMPLETION_H
+#define ASYNC_COMPLETION_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Cross-thread completion signal built on a futex sequence counter. Each
+// signal() advances the sequence; a waiter takes sequence() before checking
+// for work and passes it to wait(), which returns once the sequence has moved
+// on. Signals that arrive before the waiter sleeps are therefore never lost,
+// and any number of them wake it only once. Waiters may optionally spin for a
+// while before sleeping to avoid the cost of a futex wake-up when the signal
+// is expected soon. signal() makes a system call only if someone sleeps.
+
+#include <atomic>
+#include <cstdint>
+
+struct async_completion
+{
+  explicit async_completion(unsigned spin = 0) : m_spin(spin) {}
+  uint32_t sequence(void) const { return m_sequence.load(std::memory_order_acquire); }
+  void     signal(void);
+  void     wait(uint32_t seen) const;       //< returns once sequence() != seen
+  void     set_spin(unsigned iterations) { m_spin = iterations; }
+private:
+  std::atomic<uint32_t>         m_sequence{0};
+  mutable std::atomic<uint32_t> m_sleepers{0};
+  unsigned                      m_spin;     //< polls before sleeping
+};
+
+#endif /*ASYNC_COMPLETION_H*/
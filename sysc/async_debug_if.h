@@ -0,0 +1,20 @@
+#ifndef ASYNC_DEBUG_IF_H
+#define ASYNC_DEBUG_IF_H
+
+#include "seqlock.h"
+#include <systemc>
+
+// Debug access that may be called from an OS thread while SystemC runs, for
+// targets that can serve it without involving the scheduler. Like
+// transport_dbg it has no side effects and takes no simulated time; it returns
+// the number of bytes transferred, or 0 to leave the access to transport_dbg
+// (e.g. for registers whose value depends on simulated time). The target's storage is guarded by a
+// seqlock; an initiator that writes it through a DMI pointer must bracket the
+// write with async_debug_lock().
+struct async_debug_if : virtual sc_core::sc_interface
+{
+  virtual unsigned int async_debug_read(sc_dt::uint64 address, unsigned char* data_ptr, unsigned int data_len) = 0;
+  virtual seqlock&     async_debug_lock(void) = 0;
+};
+
+#endif /*ASYNC_DEBUG_IF_H*/
@@ -2,18 +2,9 @@
 #define ASYNC_SYSC_IF_H
 
 #include "tlmx_packet.h"
-#include <systemc>
+#include "async_channel.h"
 
-struct async_sysc_if : sc_core::sc_interface
-{
-  virtual bool nb_get(tlmx_packet_ptr& tlmx_payload_ptr)      = 0;
-  virtual bool can_get(void) const                            = 0;
-  virtual void get(tlmx_packet_ptr& tlmx_payload_ptr)         = 0;
-  virtual tlmx_packet_ptr& get(void)                          = 0;
-  virtual void nb_put(tlmx_packet_ptr tlmx_payload_ptr)       = 0;
-  virtual const sc_core::sc_event& default_event(void) const  = 0;
-  virtual const sc_core::sc_event& sysc_put_event(void) const = 0;
-  virtual const sc_core::sc_event& sysc_get_event(void) const = 0;
-};
+// SystemC side of tlmx_channel (see basic_async_sysc_if)
+typedef basic_async_sysc_if<tlmx_packet_ptr> async_sysc_if;
 
 #endif /*ASYNC_SYSC_IF_H*/
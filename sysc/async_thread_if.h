@@ -2,14 +2,33 @@
 #define ASYNC_THREAD_IF_H
 
 #include "tlmx_packet.h"
+#include "tlmx_frame.h"
+#include "async_channel.h"
+#include <cstdint>
 
-struct async_thread_if
+// Priority classes of requests travelling to SystemC, highest first
+enum tlmx_lane_t
+{ TLMX_LANE_URGENT  //< debug accesses
+, TLMX_LANE_NORMAL  //< register reads and writes
+, TLMX_LANE_BULK    //< batches and long transfers
+, TLMX_LANES
+};
+#define TLMX_BULK_DATA_LEN 64 /*< longer plain accesses travel as bulk */
+
+inline tlmx_lane_t tlmx_lane_of(const tlmx_packet& packet)
+{
+  tlmx_command_t command = tlmx_command_t(packet.command);
+  if (command == TLMX_DEBUG_READ or command == TLMX_DEBUG_WRITE) return TLMX_LANE_URGENT;
+  if (command == TLMX_BATCH or packet.data_len > TLMX_BULK_DATA_LEN) return TLMX_LANE_BULK;
+  return TLMX_LANE_NORMAL;
+}
+
+// OS thread side of tlmx_channel (see basic_async_thread_if), which can
+// also choose the lane
+struct async_thread_if : virtual basic_async_thread_if<tlmx_packet_ptr>
 {
-  virtual void push(tlmx_packet_ptr  tlmx_payload_ptr) = 0;
-  virtual bool can_pull(void) const = 0;
-  virtual bool nb_pull(tlmx_packet_ptr& tlmx_payload_ptr) = 0;
-  virtual void wait_for_get (void) const = 0;
-  virtual void wait_for_put (void) const = 0;
+  using basic_async_thread_if<tlmx_packet_ptr>::push; //< in lane tlmx_lane_of()
+  virtual void push(tlmx_packet_ptr  tlmx_payload_ptr, tlmx_lane_t lane) = 0;
 };
 
 #endif /*ASYNC_THREAD_IF_H*/
@@ -0,0 +1,160 @@
+// FILE: checkpoint.cpp
+
+////////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "checkpoint.h"
+#include "report.h"
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace sc_core;
+namespace {
+  static char const* const MSGID = "/Doulos/example/checkpoint";
+  static char const  CHECKPOINT_MAGIC[8] = { 'T','L','M','X','C','K','P','T' };
+  static uint32_t const CHECKPOINT_VERSION = 2;
+
+  // Resolutions are powers of ten from 1 fs to 1 s, so this is exact
+  uint64_t resolution_fs(void)
+  {
+    return uint64_t(sc_get_time_resolution().to_seconds()*1e15 + 0.5);
+  }
+
+  bool write_all(int fd, const void* data, size_t length)
+  {
+    const char* next = static_cast<const char*>(data);
+    while (length != 0) {
+      ssize_t written = write(fd, next, length);
+      if (written < 0 and errno == EINTR) continue;
+      if (written <= 0) return false;
+      next   += written;
+      length -= written;
+    }//endwhile
+    return true;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Written to a temporary name and renamed, so a reader never maps half a file
+bool checkpoint_save(const string& path, const sparse_memory& memory, const sc_time& now)
+{
+  string temporary = path + ".tmp";
+  int fd = open(temporary.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+  if (fd < 0) {
+    REPORT_ERROR("Unable to create checkpoint " << temporary << ": " << strerror(errno));
+    return false;
+  }
+
+  vector<uint64_t> index;
+  index.reserve(memory.pages_allocated());
+  memory.for_each_page([&](uint64_t page, const uint8_t*) { index.push_back(page); });
+
+  vector<uint8_t> first(memory.page_size(), 0); //< header, padded to a page
+  checkpoint_header_t* header = reinterpret_cast<checkpoint_header_t*>(first.data());
+  memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic));
+  header->version       = CHECKPOINT_VERSION;
+  header->page_bits     = memory.page_bits();
+  header->time_value    = now.value();
+  header->resolution_fs = resolution_fs();
+  header->memory_size   = memory.size();
+  header->page_count    = index.size();
+  header->index_offset  = (index.size()+1) * memory.page_size();
+
+  bool ok = write_all(fd, first.data(), first.size());
+  memory.for_each_page([&](uint64_t, const uint8_t* data) {
+    ok = ok and write_all(fd, data, memory.page_size());
+  });
+  ok = ok and write_all(fd, index.data(), index.size()*sizeof(uint64_t));
+  ok = (close(fd) == 0) and ok;
+  if (not ok or rename(temporary.c_str(), path.c_str()) != 0) {
+    REPORT_ERROR("Unable to write checkpoint " << path << ": " << strerror(errno));
+    unlink(temporary.c_str());
+    return false;
+  }
+  REPORT_INFO("Saved checkpoint " << path << " at " << now << " with " << index.size() << " pages");
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+checkpoint_image::checkpoint_image(const string& path)
+: m_path(path)
+, m_base(nullptr)
+, m_length(0)
+, m_header(nullptr)
+{
+  int fd = open(path.c_str(), O_RDONLY|O_CLOEXEC);
+  struct stat status;
+  if (fd < 0 or fstat(fd, &status) != 0) {
+    REPORT_FATAL("Unable to open checkpoint " << path << ": " << strerror(errno));
+  }
+  m_length = status.st_size;
+  if (m_length < sizeof(checkpoint_header_t)) {
+    REPORT_FATAL("Checkpoint " << path << " is truncated");
+  }
+  // Private and writable: restored pages are copied only when written
+  void* mapped = mmap(nullptr, m_length, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    REPORT_FATAL("Unable to map checkpoint " << path << ": " << strerror(errno));
+  }
+  m_base   = static_cast<uint8_t*>(mapped);
+  m_header = reinterpret_cast<const checkpoint_header_t*>(m_base);
+  if ( memcmp(m_header->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0
+    or m_header->version != CHECKPOINT_VERSION
+    or m_header->page_bits < 12 or m_header->page_bits > 30
+    or m_header->index_offset != (m_header->page_count+1) << m_header->page_bits
+    or m_length < m_header->index_offset + m_header->page_count*sizeof(uint64_t)
+  ) {
+    REPORT_FATAL("File " << path << " is not a compatible checkpoint");
+  }
+}
+
+checkpoint_image::~checkpoint_image(void)
+{
+  if (m_base != nullptr) munmap(m_base, m_length);
+}
+
+sc_time checkpoint_image::time(void) const
+{
+  // Exact only at the resolution it was saved with; a double would round
+  if (m_header->resolution_fs != resolution_fs()) {
+    REPORT_FATAL("Checkpoint " << m_path << " was saved with a " << m_header->resolution_fs
+                 << " fs time resolution, not " << sc_get_time_resolution());
+  }
+  return sc_time::from_value(m_header->time_value);
+}
+
+void checkpoint_image::restore(sparse_memory& memory) const
+{
+  if (memory.size() != m_header->memory_size or memory.page_bits() != m_header->page_bits) {
+    REPORT_FATAL("Checkpoint " << m_path << " does not match the memory being restored");
+  }
+  const uint64_t* index = reinterpret_cast<const uint64_t*>(m_base + m_header->index_offset);
+  uint64_t        pages = (memory.size() + memory.page_size() - 1) >> m_header->page_bits;
+  for (uint64_t i=0; i!=m_header->page_count; ++i) {
+    if (index[i] >= pages) {
+      REPORT_FATAL("Checkpoint " << m_path << " has a page beyond the memory");
+    }
+    memory.attach(index[i], m_base + ((i+1) << m_header->page_bits));
+  }//endfor
+  REPORT_INFO("Restored checkpoint " << m_path << " at " << time() << " with " << m_header->page_count << " pages");
+}
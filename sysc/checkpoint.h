@@ -0,0 +1,64 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Snapshot of the simulated state in a file laid out for mmap: one header
+// page, then every allocated page of the device memory at a page-aligned
+// offset, then the page numbers. Restoring maps the file privately and
+// attaches its pages to a sparse_memory in place, so start-up costs a few
+// system calls however large the memory, and simulators started from the
+// same checkpoint share its pages until they write them (copy-on-write).
+
+#include "sparse_memory.h"
+#include <systemc>
+#include <string>
+
+struct checkpoint_header_t
+{
+  char     magic[8];      //< "TLMXCKPT"
+  uint32_t version;
+  uint32_t page_bits;
+  uint64_t time_value;    //< simulation time when saved, in resolution units
+  uint64_t resolution_fs; //< time resolution it was saved with
+  uint64_t memory_size;   //< bytes
+  uint64_t page_count;    //< pages stored
+  uint64_t index_offset;  //< file offset of page_count uint64_t page numbers
+};
+
+// Write memory and the current time to path; false (reported) on failure
+bool checkpoint_save(const std::string& path, const sparse_memory& memory, const sc_core::sc_time& now);
+
+// A checkpoint mapped for restoring; REPORT_FATAL if the file is not one
+struct checkpoint_image
+{
+  explicit checkpoint_image(const std::string& path);
+  ~checkpoint_image(void);
+  checkpoint_image(const checkpoint_image&) = delete;
+  checkpoint_image& operator=(const checkpoint_image&) = delete;
+  uint64_t         memory_size(void) const { return m_header->memory_size; }
+  unsigned         page_bits  (void) const { return m_header->page_bits; }
+  sc_core::sc_time time       (void) const; //< REPORT_FATAL if saved at another resolution
+  void             restore    (sparse_memory& memory) const; //< memory must be empty and match
+private:
+  std::string                m_path;
+  uint8_t*                   m_base;
+  size_t                     m_length;
+  const checkpoint_header_t* m_header;
+};
+
+#endif /*CHECKPOINT_H*/
@@ -20,6 +20,11 @@
 #include "dev.h"
 #include "report.h"
 #include "sc_literals.h"
+#include "masked_copy.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
 using namespace sc_core;
 
@@ -29,35 +34,111 @@ namespace {
   // Embed file version information into object to help forensics
   static char const* const RCSID = "(@)$Id: dev.cpp,v 1.0 2013/02/04 18:13:33 dcblack Exp $";
   //                                        FILENAME VER DATE     TIME  USERNAME
+
+  // Value of -name=VALUE from the command line, or empty
+  std::string option(const std::string& name)
+  {
+    std::string value;
+    for (int i=1; i<sc_argc(); ++i) {
+      std::string arg(sc_argv()[i]);
+      if (arg.find(name) == 0) value = arg.substr(name.size());
+    }//endfor
+    return value;
+  }
+
+  // -memory=BYTES (with optional k, M or G suffix) from the command line
+  sc_dt::uint64 memory_size(sc_dt::uint64 default_size)
+  {
+    std::string value = option("-memory=");
+    if (value.empty()) return default_size;
+    char* suffix;
+    sc_dt::uint64 size = strtoull(value.c_str(), &suffix, 0);
+    switch (*suffix) {
+      case 'k': case 'K': size <<= 10; break;
+      case 'm': case 'M': size <<= 20; break;
+      case 'g': case 'G': size <<= 30; break;
+    }
+    return size;
+  }
+
+  // -timers=N from the command line: countdown timers at the start of the device
+  size_t timers_option(void)
+  {
+    std::string value = option("-timers=");
+    return value.empty() ? 4 : strtoul(value.c_str(), nullptr, 0);
+  }
+
+  checkpoint_image* restore_option(void)
+  {
+    std::string path = option("-restore=");
+    return path.empty() ? nullptr : new checkpoint_image(path);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Constructor <<
-SC_HAS_PROCESS(dev_module);
-dev_module::dev_module
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+basic_dev_module<BUSWIDTH,RegT,Count>::basic_dev_module
 ( sc_module_name instance_name
 )
 : sc_module(instance_name)
 , target_socket("target_socket")
-, m_register_count(8)
+, m_checkpoint(restore_option())
+, m_save_path(option("-save="))
+, m_register( m_checkpoint ? m_checkpoint->memory_size()
+            : memory_size(Count*sizeof(RegT))
+            , m_checkpoint ? m_checkpoint->page_bits() : 12
+            )
 , m_latency(10_ns)
+, m_timers(timers_option(), m_latency)
+, m_status_words((m_timers.size() + BUSWIDTH - 1) / BUSWIDTH)
+, m_timer_bytes((m_status_words + m_timers.size()) * BYTES)
+, m_dmi_enabled(true)
 {
   // Misc. initialization
-  m_byte_width = target_socket.get_bus_width()/8;
-  m_register = new int[m_register_count];
+  if (m_checkpoint) m_checkpoint->restore(m_register);
+  if (m_timer_bytes > m_register.size()) {
+    REPORT_FATAL(m_timers.size() << " timers need " << m_timer_bytes << " bytes; increase -memory");
+  }
   // Register methods
-  target_socket.register_b_transport  ( this, &dev_module::b_transport   );
-  target_socket.register_transport_dbg( this, &dev_module::transport_dbg );
-  // Register processes - NONE
-  REPORT_INFO("Constructed " << " " << name());
+  target_socket.register_b_transport  ( this, &basic_dev_module::b_transport   );
+  target_socket.register_transport_dbg( this, &basic_dev_module::transport_dbg );
+  target_socket.register_get_direct_mem_ptr( this, &basic_dev_module::get_direct_mem_ptr );
+  // Register processes
+  SC_METHOD(timer_process);
+    sensitive << m_timers.expiry_event();
+    dont_initialize();
+  REPORT_INFO("Constructed " << " " << name() << " with " << m_register.size() << " bytes in "
+           << m_register.page_size() << "-byte pages");
 }//endconstructor
 
 ///////////////////////////////////////////////////////////////////////////////
 // Destructor <<
-dev_module::~dev_module(void)
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+basic_dev_module<BUSWIDTH,RegT,Count>::~basic_dev_module(void)
+{
+  REPORT_INFO("Destroyed " << name() << " having touched " << m_register.pages_allocated() << " pages"
+           << " and counted " << m_timers.expirations() << " timer expiries");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Callbacks
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+void basic_dev_module<BUSWIDTH,RegT,Count>::end_of_simulation(void)
 {
-  delete [] m_register;
-  REPORT_INFO("Destroyed " << name());
+  if (not m_save_path.empty()) checkpoint_save(m_save_path, m_register, sc_time_stamp());
+}
+
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+void basic_dev_module<BUSWIDTH,RegT,Count>::timer_process(void)
+{
+  m_timers.update();
+}
+
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+sc_time basic_dev_module<BUSWIDTH,RegT,Count>::restored_time(void) const
+{
+  return m_checkpoint ? m_checkpoint->time() : SC_ZERO_TIME;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -73,52 +154,148 @@ dev_module::~dev_module(void)
 //  #####  ##### #    #   # #     # #     #  ####  #       ####  #   #    #    
 //
 ///////////////////////////////////////////////////////////////////////////////
-void dev_module::b_transport(tlm::tlm_generic_payload& trans, sc_time& delay)
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+void basic_dev_module<BUSWIDTH,RegT,Count>::b_transport(tlm::tlm_generic_payload& trans, sc_time& delay)
 {
   tlm::tlm_command command = trans.get_command();
   sc_dt::uint64    address = trans.get_address();
   unsigned char*   data_ptr = trans.get_data_ptr();
   unsigned int     data_length = trans.get_data_length();
   unsigned char*   byte_enables = trans.get_byte_enable_ptr();
+  unsigned int     byte_enable_length = trans.get_byte_enable_length();
   unsigned int     streaming_width = trans.get_streaming_width();
+  unsigned int     span = std::min(streaming_width, data_length); //< bytes of memory accessed
 
-  // Obliged to check address range and check for unsupported features,
-  //   i.e. byte enables, streaming, and bursts
+  // Obliged to check address range and check for unsupported features
   // Can ignore DMI hint and extensions
   // Using the SystemC report handler is an acceptable way of signalling an error
 
-  if (address >= sc_dt::uint64(m_register_count) * m_byte_width) {
+  if (address >= m_register.size()) {
     trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
     return;
-  } else if (address % m_byte_width) {
+  } else if (address & MASK) {
     // Only allow aligned bit width transfers
     SC_REPORT_WARNING(MSGID,"Misaligned address");
     trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
     return;
-  } else if (byte_enables != 0) {
-    // No support for byte enables
+  } else if (byte_enables != 0 && byte_enable_length == 0) {
     trans.set_response_status( tlm::TLM_BYTE_ENABLE_ERROR_RESPONSE );
     return;
-  } else if ((data_length % m_byte_width) != 0 || streaming_width < data_length || data_length == 0
-      || (address+data_length)/m_byte_width >= m_register_count) {
-    // Only allow word-multiple transfers within memory size
+  } else if ((data_length & MASK) != 0 || (span & MASK) != 0 || span == 0
+      || span > m_register.size() - address) {
+    // Only allow word-multiple transfers (and streaming widths) within memory size
+    trans.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
+    return;
+  } else if (address < m_timer_bytes && byte_enables != 0) {
+    // Timer registers are accessed whole
+    trans.set_response_status( tlm::TLM_BYTE_ENABLE_ERROR_RESPONSE );
+    return;
+  } else if (address < m_timer_bytes && (span < data_length || data_length > m_timer_bytes - address)) {
+    // Timer accesses neither stream nor run on into memory
     trans.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
     return;
   }//endif
 
-  // Obliged to implement read and write commands
-  if ( command == tlm::TLM_READ_COMMAND ) {
-    memcpy(data_ptr, &m_register[address/m_byte_width], data_length);
+  // Obliged to implement read and write commands; a single register (the
+  // common case) is one fixed-size copy
+  if (address < m_timer_bytes) {
+    timer_access(command, address, data_ptr, data_length, delay);
+  } else if (byte_enables != 0 || span < data_length) {
+    transfer_lanes(command, address, data_ptr, data_length, span, byte_enables, byte_enable_length);
+  } else if ( command == tlm::TLM_READ_COMMAND ) {
+    if (data_length == sizeof(RegT)) m_register.read_word<sizeof(RegT)>(address, data_ptr);
+    else                             m_register.read(address, data_ptr, data_length);
   } else if ( command == tlm::TLM_WRITE_COMMAND ) {
-    memcpy(&m_register[address/m_byte_width], data_ptr, data_length);
+    m_register_lock.write_begin();
+    if (data_length == sizeof(RegT)) m_register.write_word<sizeof(RegT)>(address, data_ptr);
+    else                             m_register.write(address, data_ptr, data_length);
+    m_register_lock.write_end();
   }//endif
 
   // Memory access time per bus value
-  delay += (m_latency * data_length/m_byte_width);
+  delay += m_latency * double(data_length >> SHIFT);
+
+  // Plain storage beyond the timers, so initiators may use DMI instead once
+  // the page exists: granting it for an untouched page would allocate it
+  trans.set_dmi_allowed( m_dmi_enabled && address >= m_timer_bytes && m_register.touched(address) );
 
   // Obliged to set response status to indicate successful completion
   trans.set_response_status( tlm::TLM_OK_RESPONSE );
-}//end dev_module::b_transport
+}//end basic_dev_module<BUSWIDTH,RegT,Count>::b_transport
+
+////////////////////////////////////////////////////////////////////////////////
+// Byte-enabled and streaming accesses: data byte i is at address + i%width
+// and is transferred only if its byte enable (if any) is set.
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+void basic_dev_module<BUSWIDTH,RegT,Count>::transfer_lanes
+( tlm::tlm_command command, sc_dt::uint64 address, unsigned char* data_ptr, unsigned int data_length
+, unsigned int width, const unsigned char* byte_enables, unsigned int byte_enable_length
+)
+{
+  if ( command == tlm::TLM_READ_COMMAND ) {
+    if (byte_enables == 0) {
+      // Every beat reads the same bytes: read one and copy it along
+      m_register.read(address, data_ptr, width);
+      replicate(data_ptr, width, data_length);
+    } else {
+      for (unsigned int beat=0; beat < data_length; beat += width) {
+        m_register.read_masked(address, data_ptr + beat, std::min(width, data_length - beat)
+                              , byte_enables, byte_enable_length, beat);
+      }//endfor
+    }
+  } else if ( command == tlm::TLM_WRITE_COMMAND ) {
+    m_register_lock.write_begin();
+    if (byte_enables == 0) {
+      // Only the last write to each byte lasts: the final (maybe partial)
+      // beat, and the rest of the beat before it
+      unsigned int last = (data_length - 1) / width * width;
+      unsigned int tail = data_length - last;
+      m_register.write(address, data_ptr + last, tail);
+      if (tail < width) m_register.write(address + tail, data_ptr + last - width + tail, width - tail);
+    } else {
+      for (unsigned int beat=0; beat < data_length; beat += width) {
+        m_register.write_masked(address, data_ptr + beat, std::min(width, data_length - beat)
+                               , byte_enables, byte_enable_length, beat);
+      }//endfor
+    }
+    m_register_lock.write_end();
+  }//endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Timer registers, evaluated at the initiator's local time (now + offset):
+// status words first, a bit per timer (writing 1 clears it), then the counts.
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+void basic_dev_module<BUSWIDTH,RegT,Count>::timer_access
+( tlm::tlm_command command, sc_dt::uint64 address, unsigned char* data_ptr, unsigned int data_length
+, const sc_time& offset
+)
+{
+  for (unsigned int done=0; done < data_length; done += BYTES) {
+    sc_dt::uint64 word = (address + done) >> SHIFT;
+    sc_dt::uint64 first = word * BUSWIDTH; //< timer of status bit 0
+    RegT value = 0;
+    if ( command == tlm::TLM_READ_COMMAND ) {
+      if (word < m_status_words) {
+        for (unsigned int bit=0; bit!=BUSWIDTH and first+bit < m_timers.size(); ++bit) {
+          if (m_timers.expired(first+bit, offset)) value |= RegT(1) << bit;
+        }//endfor
+      } else {
+        value = RegT(m_timers.count(word - m_status_words, offset));
+      }
+      memcpy(data_ptr + done, &value, BYTES);
+    } else if ( command == tlm::TLM_WRITE_COMMAND ) {
+      memcpy(&value, data_ptr + done, BYTES);
+      if (word < m_status_words) {
+        for (unsigned int bit=0; bit!=BUSWIDTH and first+bit < m_timers.size(); ++bit) {
+          if (value & (RegT(1) << bit)) m_timers.clear(first+bit, offset);
+        }//endfor
+      } else {
+        m_timers.load(word - m_status_words, value, offset);
+      }
+    }//endif
+  }//endfor
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -131,7 +308,8 @@ void dev_module::b_transport(tlm::tlm_generic_payload& trans, sc_time& delay)
 //    #    #   # #   # #   #  ###  #     ##  #   #    # ##### ###   ####   ###  
 //
 ////////////////////////////////////////////////////////////////////////////////
-unsigned int dev_module::transport_dbg(tlm::tlm_generic_payload& trans)
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+unsigned int basic_dev_module<BUSWIDTH,RegT,Count>::transport_dbg(tlm::tlm_generic_payload& trans)
 {
   int              transferred = 0;
   tlm::tlm_command command = trans.get_command();
@@ -146,27 +324,257 @@ unsigned int dev_module::transport_dbg(tlm::tlm_generic_payload& trans)
   // Can ignore DMI hint and extensions
   // Using the SystemC report handler is an acceptable way of signalling an error
 
-  if (address >= sc_dt::uint64(m_register_count) * m_byte_width) {
+  if (address >= m_register.size()) {
     trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
     return 0;
-  } else if (address % m_byte_width) {
+  } else if (address & MASK) {
     // Only allow aligned bit width transfers
     trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
     return 0;
   }//endif
+  if (data_length > m_register.size() - address) {
+    data_length = m_register.size() - address; //< debug accesses are truncated
+  }
 
   // Obliged to implement read and write commands
-  if ( command == tlm::TLM_READ_COMMAND ) {
-    memcpy(data_ptr, &m_register[address/m_byte_width], data_length);
+  if (address < m_timer_bytes) {
+    // Whole timer registers only, stopping where memory begins
+    data_length = std::min<sc_dt::uint64>(data_length, m_timer_bytes - address) & ~MASK;
+    timer_access(command, address, data_ptr, data_length, SC_ZERO_TIME);
+    transferred = data_length;
+  } else if ( command == tlm::TLM_READ_COMMAND ) {
+    m_register.read(address, data_ptr, data_length);
     transferred = data_length;
   } else if ( command == tlm::TLM_WRITE_COMMAND ) {
-    memcpy(&m_register[address/m_byte_width], data_ptr, data_length);
+    m_register_lock.write_begin();
+    m_register.write(address, data_ptr, data_length);
+    m_register_lock.write_end();
     transferred = data_length;
   }//endif
 
   // Obliged to set response status to indicate successful completion
   trans.set_response_status( tlm::TLM_OK_RESPONSE );
   return transferred;
-}//end dev_module::transport_dbg
+}//end basic_dev_module<BUSWIDTH,RegT,Count>::transport_dbg
+
+////////////////////////////////////////////////////////////////////////////////
+// Grant read/write access to the page holding the address once it has been
+// written (the initiator may write through the pointer, so it must exist).
+// Latencies are per bus value, as in b_transport; the initiator scales them
+// by the values accessed.
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+bool basic_dev_module<BUSWIDTH,RegT,Count>::get_direct_mem_ptr(tlm::tlm_generic_payload& trans, tlm::tlm_dmi& dmi)
+{
+  sc_dt::uint64 address = trans.get_address();
+  sc_dt::uint64 last    = m_register.size() - 1;
+  if (not m_dmi_enabled or address > last) {
+    // Tell the initiator not to ask again anywhere in this device
+    dmi.set_start_address( 0 );
+    dmi.set_end_address( last );
+    dmi.set_granted_access( tlm::tlm_dmi::DMI_ACCESS_NONE );
+    return false;
+  } else if (address < m_timer_bytes) {
+    // Timers are computed on access, so never direct
+    dmi.set_start_address( 0 );
+    dmi.set_end_address( m_timer_bytes - 1 );
+    dmi.set_granted_access( tlm::tlm_dmi::DMI_ACCESS_NONE );
+    return false;
+  }//endif
+  sc_dt::uint64 base  = m_register.page_base(address);
+  sc_dt::uint64 start = std::max(base, m_timer_bytes); //< page may begin with timers
+  sc_dt::uint64 end   = std::min(last, base + m_register.page_size() - 1);
+  if (not m_register.touched(address)) {
+    // Not until the page is written, so reads alone never allocate memory;
+    // b_transport sets the DMI hint again once it exists
+    dmi.set_start_address( start );
+    dmi.set_end_address( end );
+    dmi.set_granted_access( tlm::tlm_dmi::DMI_ACCESS_NONE );
+    return false;
+  }//endif
+  dmi.set_dmi_ptr( m_register.page(address) + (start - base) );
+  dmi.set_start_address( start );
+  dmi.set_end_address( end );
+  dmi.set_read_latency( m_latency );
+  dmi.set_write_latency( m_latency );
+  dmi.allow_read_write();
+  return true;
+}//end basic_dev_module<BUSWIDTH,RegT,Count>::get_direct_mem_ptr
+
+////////////////////////////////////////////////////////////////////////////////
+// Called from an OS thread: copy registers out without the scheduler, retrying
+// if the SystemC thread wrote them meanwhile. Same checks as transport_dbg,
+// but timers are left to transport_dbg.
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+unsigned int basic_dev_module<BUSWIDTH,RegT,Count>::async_debug_read(sc_dt::uint64 address, unsigned char* data_ptr, unsigned int data_len)
+{
+  sc_dt::uint64 size = m_register.size();
+  if (address >= size or (address & MASK)) return 0;
+  if (address < m_timer_bytes) return 0; //< timers need SystemC time: use transport_dbg
+  if (data_len > size - address) data_len = size - address;
+  uint32_t seen;
+  do {
+    seen = m_register_lock.read_begin();
+    m_register.peek(address, data_ptr, data_len);
+  } while (m_register_lock.read_retry(seen));
+  return data_len;
+}//end basic_dev_module<BUSWIDTH,RegT,Count>::async_debug_read
+
+template<unsigned int BUSWIDTH, typename RegT, sc_dt::uint64 Count>
+void basic_dev_module<BUSWIDTH,RegT,Count>::set_dmi_enabled(bool enabled)
+{
+  if (m_dmi_enabled and not enabled) {
+    target_socket->invalidate_direct_mem_ptr( 0, m_register.size() - 1 );
+  }
+  m_dmi_enabled = enabled;
+}//end basic_dev_module<BUSWIDTH,RegT,Count>::set_dmi_enabled
+
+template struct basic_dev_module<32, uint32_t, 8>;
+template struct basic_dev_module<64, uint64_t, 8>;
+
+#ifdef TEST_DEV_MODULE
+///////////////////////////////////////////////////////////////////////////////
+// Micro-benchmark: b_transport calls per second for single-register reads and
+// writes, comparing dev_module with a reference that makes the same checks
+// using the socket width at run time (as dev_module did before it became a
+// template). Both use the same sparse_memory. Then the rate of writing and
+// reading bursts with and without a byte enable mask (memory must be at least
+// one burst, e.g. -memory=1M).
+//
+//   usage: dev.x [-count=N] [-registers=N] [-burst=BYTES] [-memory=SIZE]
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+  struct generic_dev
+  {
+    generic_dev(int byte_width, sc_dt::uint64 size)
+    : m_register(size), m_byte_width(byte_width), m_latency(10_ns) {}
+    void b_transport(tlm::tlm_generic_payload& trans, sc_time& delay)
+    {
+      sc_dt::uint64 address = trans.get_address();
+      unsigned int  data_length = trans.get_data_length();
+      if (address >= m_register.size()) {
+        trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+        return;
+      } else if (address % m_byte_width) {
+        trans.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+        return;
+      } else if (trans.get_byte_enable_ptr() != 0) {
+        trans.set_response_status( tlm::TLM_BYTE_ENABLE_ERROR_RESPONSE );
+        return;
+      } else if ((data_length % m_byte_width) != 0 || trans.get_streaming_width() < data_length
+          || data_length == 0 || data_length > m_register.size() - address) {
+        trans.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
+        return;
+      }//endif
+      if ( trans.is_read() ) {
+        m_register.read(address, trans.get_data_ptr(), data_length);
+      } else if ( trans.is_write() ) {
+        m_register_lock.write_begin();
+        m_register.write(address, trans.get_data_ptr(), data_length);
+        m_register_lock.write_end();
+      }//endif
+      delay += (m_latency * data_length/m_byte_width);
+      trans.set_dmi_allowed( true );
+      trans.set_response_status( tlm::TLM_OK_RESPONSE );
+    }
+    sparse_memory    m_register;
+    seqlock          m_register_lock;
+    int              m_byte_width;
+    sc_time          m_latency;
+  };
+
+  // Calls per second of target.b_transport over count alternating writes and
+  // reads walking through registers from base
+  template<typename Target>
+  double calls_per_second(Target& target, unsigned count, unsigned registers, sc_dt::uint64 base)
+  {
+    typedef std::chrono::steady_clock clock;
+    uint32_t value = 0;
+    tlm::tlm_generic_payload trans;
+    trans.set_data_ptr( reinterpret_cast<unsigned char*>(&value) );
+    trans.set_data_length( sizeof(value) );
+    trans.set_streaming_width( sizeof(value) );
+    sc_time delay;
+    auto start = clock::now();
+    for (unsigned i=0; i!=count; ++i) {
+      trans.set_command( (i & 1) ? tlm::TLM_READ_COMMAND : tlm::TLM_WRITE_COMMAND );
+      trans.set_address( base + ((i >> 1) % registers) * sizeof(value) );
+      trans.set_response_status( tlm::TLM_INCOMPLETE_RESPONSE );
+      value += i;
+      target.b_transport(trans, delay);
+      if (not trans.is_response_ok()) {
+        REPORT_FATAL("Benchmark access failed: " << trans.get_response_string());
+      }
+    }//endfor
+    std::chrono::duration<double> elapsed = clock::now() - start;
+    return count / elapsed.count();
+  }
+
+  // Bytes per second of count alternating burst writes and reads, with the
+  // byte enable mask given (if any)
+  double bytes_per_second(dev_module& target, unsigned count, unsigned burst, sc_dt::uint64 base, std::vector<unsigned char>* enables)
+  {
+    typedef std::chrono::steady_clock clock;
+    std::vector<unsigned char> data(burst, 0x5a);
+    tlm::tlm_generic_payload trans;
+    trans.set_address( base );
+    trans.set_data_ptr( data.data() );
+    trans.set_data_length( burst );
+    trans.set_streaming_width( burst );
+    if (enables != nullptr) {
+      trans.set_byte_enable_ptr( enables->data() );
+      trans.set_byte_enable_length( enables->size() );
+    }
+    sc_time delay;
+    auto start = clock::now();
+    for (unsigned i=0; i!=count; ++i) {
+      trans.set_command( (i & 1) ? tlm::TLM_READ_COMMAND : tlm::TLM_WRITE_COMMAND );
+      trans.set_response_status( tlm::TLM_INCOMPLETE_RESPONSE );
+      target.b_transport(trans, delay);
+      if (not trans.is_response_ok()) {
+        REPORT_FATAL("Benchmark burst failed: " << trans.get_response_string());
+      }
+    }//endfor
+    std::chrono::duration<double> elapsed = clock::now() - start;
+    return double(count) * burst / elapsed.count();
+  }
+}
+
+int sc_main(int argc, char* argv[])
+{
+  unsigned count{10000000}, registers{1024}, burst{4096};
+  for (int i=1; i<argc; ++i) {
+    std::string arg(argv[i]);
+    if      (arg.find("-count=")     == 0) count     = std::max(1,atoi(arg.substr(7).c_str()));
+    else if (arg.find("-registers=") == 0) registers = std::max(1,atoi(arg.substr(11).c_str()));
+    else if (arg.find("-burst=")     == 0) burst     = std::max(4,atoi(arg.substr(7).c_str())) & ~3;
+  }//endfor
+  // -memory=SIZE is read by dev_module itself
+  dev_module  templated("templated");
+  generic_dev reference(4, templated.size());
+  sc_dt::uint64 base = templated.timers_end(); //< plain memory from here
+  if (templated.size() - base < 4) {
+    REPORT_FATAL("No memory beyond the timers; use -memory=SIZE");
+  }
+  registers = std::min<sc_dt::uint64>(registers, (templated.size() - base)/4);
+  double generic = calls_per_second(reference, count, registers, base);
+  double fixed   = calls_per_second(templated, count, registers, base);
+  printf("b_transport, %u single-register accesses over %u registers\n", count, registers);
+  printf("  runtime width  %12.0f calls/s\n", generic);
+  printf("  dev_module<32> %12.0f calls/s (%.2fx)\n", fixed, fixed/generic);
+
+  burst = std::min<sc_dt::uint64>(burst, templated.size() - base) & ~3;
+  std::vector<unsigned char> enables{ 0xff, 0xff, 0x00, 0xff };
+  unsigned bursts = std::max(2u, unsigned(std::min<sc_dt::uint64>(count, (sc_dt::uint64(1) << 32) / burst)));
+  double plain  = bytes_per_second(templated, bursts, burst, base, nullptr);
+  double masked = bytes_per_second(templated, bursts, burst, base, &enables);
+  printf("b_transport, %u bursts of %u bytes\n", bursts, burst);
+  printf("  no byte enables %10.0f MB/s\n", plain/1e6);
+  printf("  byte enables    %10.0f MB/s (%.2fx)\n", masked/1e6, masked/plain);
+  return 0;
+}
+#endif /*TEST_DEV_MODULE*/
 
 //EOF
@@ -18,28 +18,89 @@
 
 #include <systemc>
 #include "tlm_utils/simple_target_socket.h"
+#include "async_debug_if.h"
+#include "sparse_memory.h"
+#include "checkpoint.h"
+#include "timer_bank.h"
+#include <memory>
+#include <string>
+#include <type_traits>
 #include <stdint.h>
 
-struct dev_module
+// Bus width and register type are fixed at compile time, so alignment,
+// length and latency arithmetic reduce to constant masks and shifts, and a
+// single-register access is a fixed-size copy. Count is the default number of
+// registers; -memory=SIZE still overrides the size at run time.
+//
+// The first registers are countdown timers (-timers=N, default 4, as
+// DEV_STATUS_REG and DEV_COUNT1..4_REG in driver.h): a status bitmap, one bit
+// per timer, then one count per timer. Writing a count loads that timer,
+// which counts down once per bus cycle; its status bit is set once it reaches
+// zero, and writing 1 to a status bit clears it. Timers are evaluated lazily
+// (see timer_bank), so they cost nothing while counting.
+constexpr unsigned int dev_log2(unsigned int n) { return n <= 1 ? 0 : 1 + dev_log2(n >> 1); }
+
+template<unsigned int BUSWIDTH = 32, typename RegT = uint32_t, sc_dt::uint64 Count = 8>
+struct basic_dev_module
 : sc_core::sc_module
+, async_debug_if
 {
+  static constexpr unsigned int BYTES = BUSWIDTH/8;         //< bytes per bus value
+  static constexpr unsigned int SHIFT = dev_log2(BYTES);    //< log2(BYTES)
+  static constexpr sc_dt::uint64 MASK = BYTES - 1;          //< misaligned address bits
+  static_assert(BUSWIDTH >= 8 and (BUSWIDTH & (BUSWIDTH-1)) == 0, "bus width must be a power of two bytes");
+  static_assert(sizeof(RegT) == BYTES, "register type must be as wide as the bus");
+  static_assert(std::is_unsigned<RegT>::value, "register type must be an unsigned integer");
+  static_assert(Count != 0, "device needs at least one register");
   // Ports
-  tlm_utils::simple_target_socket<dev_module> target_socket;
+  tlm_utils::simple_target_socket<basic_dev_module, BUSWIDTH> target_socket;
   // Constructor
-  dev_module
+  basic_dev_module
   ( sc_core::sc_module_name instance_name
   );
   // Destructor
-  virtual ~dev_module(void);
-  // SC_MODULE callbacks - NONE
+  virtual ~basic_dev_module(void);
+  // SC_MODULE callbacks
+  void end_of_simulation(void) override; //< saves a checkpoint if asked (-save=FILE)
   // TLM-2 forward methods
   void b_transport  ( tlm::tlm_generic_payload& trans, sc_core::sc_time& delay );
   unsigned int  transport_dbg( tlm::tlm_generic_payload& trans );
+  bool          get_direct_mem_ptr( tlm::tlm_generic_payload& trans, tlm::tlm_dmi& dmi );
+  // Withdraw (or restore) direct access to the memory; initiators are told
+  // to drop any pointers they hold
+  void          set_dmi_enabled( bool enabled );
+  // Debug reads from other OS threads (see async_debug_if)
+  unsigned int  async_debug_read( sc_dt::uint64 address, unsigned char* data_ptr, unsigned int data_len ) override;
+  seqlock&      async_debug_lock( void ) override { return m_register_lock; }
+  sc_dt::uint64 size( void ) const { return m_register.size(); } //< bytes
+  // Simulation time of the checkpoint restored at construction (-restore=FILE)
+  sc_core::sc_time restored_time( void ) const;
+  // Notified whenever a timer reaches zero
+  const sc_core::sc_event& timer_event( void ) const { return m_timers.expiry_event(); }
+  sc_dt::uint64 timers_end( void ) const { return m_timer_bytes; } //< first address of plain memory
 private:
-  sc_dt::uint64    m_register_count; //< number of registers in this device
-  int32_t*         m_register; // register array
-  int              m_byte_width; //< byte width of socket
+  SC_HAS_PROCESS(basic_dev_module);
+  void timer_process( void ); //< runs at each expiry to schedule the next
+  void timer_access( tlm::tlm_command command, sc_dt::uint64 address, unsigned char* data_ptr
+                   , unsigned int data_length, const sc_core::sc_time& offset );
+  void transfer_lanes( tlm::tlm_command command, sc_dt::uint64 address, unsigned char* data_ptr
+                     , unsigned int data_length, unsigned int width
+                     , const unsigned char* byte_enables, unsigned int byte_enable_length );
+  std::unique_ptr<checkpoint_image> m_checkpoint; //< restored from, kept mapped
+  std::string      m_save_path; //< checkpoint written at end of simulation
+  sparse_memory    m_register; //< registers/memory, pages allocated when touched
+  seqlock          m_register_lock; //< SystemC writes; async_debug_read reads
   sc_core::sc_time m_latency;
+  timer_bank       m_timers; //< count down once per m_latency
+  sc_dt::uint64    m_status_words; //< words of timer status bits, from address 0
+  sc_dt::uint64    m_timer_bytes; //< status then counts: addresses below are timers
+  bool             m_dmi_enabled; //< grant DMI over the register array
 };
 
+// Instantiated in dev.cpp
+extern template struct basic_dev_module<32, uint32_t, 8>;
+extern template struct basic_dev_module<64, uint64_t, 8>;
+
+typedef basic_dev_module<> dev_module; //< 32-bit bus, 8 registers
+
 #endif
@@ -0,0 +1,121 @@
+// FILE: masked_copy.cpp
+
+////////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "masked_copy.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MASKED_COPY_X86
+#endif
+
+namespace {
+  // Longest mask expanded into a pattern; longer masks are used in place
+  static const size_t PATTERN = 256;
+
+  // Blend with the mask running alongside the data (no repeat)
+  void blend_scalar(uint8_t* dst, const uint8_t* src, const uint8_t* mask, size_t length)
+  {
+    for (size_t i=0; i!=length; ++i) dst[i] = (src[i] & mask[i]) | (dst[i] & ~mask[i]);
+  }
+
+#ifdef MASKED_COPY_X86
+  __attribute__((target("sse2")))
+  void blend_sse2(uint8_t* dst, const uint8_t* src, const uint8_t* mask, size_t length)
+  {
+    size_t i = 0;
+    for (; i+16 <= length; i+=16) {
+      __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask+i));
+      __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src+i));
+      __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst+i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), _mm_or_si128(_mm_and_si128(m, s), _mm_andnot_si128(m, d)));
+    }//endfor
+    blend_scalar(dst+i, src+i, mask+i, length-i);
+  }
+
+  __attribute__((target("avx2")))
+  void blend_avx2(uint8_t* dst, const uint8_t* src, const uint8_t* mask, size_t length)
+  {
+    size_t i = 0;
+    for (; i+32 <= length; i+=32) {
+      __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask+i));
+      __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src+i));
+      __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst+i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst+i), _mm256_or_si256(_mm256_and_si256(m, s), _mm256_andnot_si256(m, d)));
+    }//endfor
+    blend_sse2(dst+i, src+i, mask+i, length-i);
+  }
+#endif
+
+  typedef void (*blend_t)(uint8_t*, const uint8_t*, const uint8_t*, size_t);
+  blend_t select_blend(void)
+  {
+#ifdef MASKED_COPY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return blend_avx2;
+    if (__builtin_cpu_supports("sse2")) return blend_sse2;
+#endif
+    return blend_scalar;
+  }
+  blend_t const blend = select_blend();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void masked_copy( uint8_t* dst, const uint8_t* src, size_t length
+                , const uint8_t* mask, size_t mask_length, size_t mask_offset )
+{
+  mask_offset %= mask_length;
+  if (mask_length > PATTERN / 2) {
+    // Long mask: run along it, wrapping back to its start
+    while (length != 0) {
+      size_t chunk = std::min(length, mask_length - mask_offset);
+      blend(dst, src, mask + mask_offset, chunk);
+      dst += chunk;
+      src += chunk;
+      length -= chunk;
+      mask_offset = 0;
+    }//endwhile
+    return;
+  }
+  // Short mask (typically one bus value): lay it out, rotated to start at
+  // mask_offset, over a whole number of repeats so each blend spans many
+  uint8_t pattern[PATTERN];
+  size_t  period = std::min(length, PATTERN - PATTERN % mask_length);
+  memcpy(pattern, mask + mask_offset, std::min(period, mask_length - mask_offset));
+  if (mask_offset != 0 and period > mask_length - mask_offset) {
+    memcpy(pattern + mask_length - mask_offset, mask, std::min(period - (mask_length - mask_offset), mask_offset));
+  }
+  replicate(pattern, std::min(period, mask_length), period);
+  while (length != 0) {
+    size_t chunk = std::min(length, period);
+    blend(dst, src, pattern, chunk);
+    dst += chunk;
+    src += chunk;
+    length -= chunk;
+  }//endwhile
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void replicate( uint8_t* dst, size_t period, size_t length )
+{
+  for (size_t filled = period; filled < length; ) {
+    size_t chunk = std::min(filled, length - filled);
+    memcpy(dst + filled, dst, chunk);
+    filled += chunk;
+  }//endfor
+}
@@ -0,0 +1,38 @@
+#ifndef MASKED_COPY_H
+#define MASKED_COPY_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Copy kernels for TLM-2 byte enables and streaming widths. A byte enable
+// mask holds 0xff (TLM_BYTE_ENABLED) or 0x00 (TLM_BYTE_DISABLED) per data
+// byte and repeats every byte_enable_length bytes. The blend is bitwise and
+// runs 32 bytes at a time with AVX2 where the CPU has it, else 16 at a time
+// with SSE2 (x86), else a byte at a time.
+
+#include <cstddef>
+#include <cstdint>
+
+// dst[i] = src[i] where enabled, unchanged where not, for i < length; byte i
+// uses mask[(mask_offset + i) % mask_length]. mask_length must not be 0.
+void masked_copy( uint8_t* dst, const uint8_t* src, size_t length
+                , const uint8_t* mask, size_t mask_length, size_t mask_offset = 0 );
+
+// Fill dst[period, length) with repeats of dst[0, period), doubling the copy
+// each time so a burst of short beats costs a few memcpy calls
+void replicate( uint8_t* dst, size_t period, size_t length );
+
+#endif /*MASKED_COPY_H*/
@@ -145,6 +145,17 @@ do {\
   SC_REPORT_WARNING(MSGID,mout.str().c_str());\
 } while (0)
 
+// For per-transaction paths: formats nothing (and so does not allocate) unless
+// SC_DEBUG verbosity is enabled
+#define REPORT_TRACE(message_stream) \
+do {\
+  if (sc_core::sc_report_handler::get_verbosity_level() >= sc_core::SC_DEBUG) {\
+    std::ostringstream mout;\
+    mout << message_stream;\
+    SC_REPORT_INFO_VERB(MSGID,mout.str().c_str(),sc_core::SC_DEBUG);\
+  }\
+} while (0)
+
 #define REPORT_DEBUG(message_stream) \
 do {\
   std::ostringstream mout;\
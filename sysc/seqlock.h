@@ -0,0 +1,61 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Sequence lock for storage with one writer thread and readers on others.
+// The writer never waits; a reader copies the data and retries if a write
+// overlapped the copy:
+//
+//   uint32_t seen;
+//   do {
+//     seen = lock.read_begin();
+//     memcpy(copy, storage, size);
+//   } while (lock.read_retry(seen));
+//
+// The writer brackets every change with write_begin()/write_end().
+
+#include <atomic>
+#include <cstdint>
+
+struct seqlock
+{
+  void write_begin(void)
+  {
+    m_sequence.store(m_sequence.load(std::memory_order_relaxed)+1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); //< odd count visible before the data changes
+  }
+  void write_end(void)
+  {
+    m_sequence.store(m_sequence.load(std::memory_order_relaxed)+1, std::memory_order_release);
+  }
+  uint32_t read_begin(void) const
+  {
+    uint32_t seen;
+    while ((seen = m_sequence.load(std::memory_order_acquire)) & 1) {} //< write in progress
+    return seen;
+  }
+  bool read_retry(uint32_t seen) const
+  {
+    std::atomic_thread_fence(std::memory_order_acquire); //< copy completes before the recheck
+    return m_sequence.load(std::memory_order_relaxed) != seen;
+  }
+private:
+  std::atomic<uint32_t> m_sequence{0}; //< odd while a write is in progress
+};
+
+#endif /*SEQLOCK_H*/
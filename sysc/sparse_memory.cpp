@@ -0,0 +1,166 @@
+// FILE: sparse_memory.cpp
+
+////////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "sparse_memory.h"
+#include "masked_copy.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  static const uint8_t ZEROS[4096] = {}; //< source for untouched pages
+}
+
+sparse_memory::sparse_memory(uint64_t size, unsigned page_bits)
+: m_size(size)
+, m_page_bits(page_bits)
+, m_leaves((((size + (uint64_t(1) << page_bits) - 1) >> page_bits) + (uint64_t(1) << LEAF_BITS) - 1) >> LEAF_BITS)
+, m_top(new std::atomic<entry_t*>[m_leaves])
+, m_last_index(~uint64_t(0))
+{
+  for (uint64_t i=0; i!=m_leaves; ++i) m_top[i].store(nullptr, std::memory_order_relaxed);
+}
+
+sparse_memory::~sparse_memory(void)
+{
+  for (uint64_t i=0; i!=m_leaves; ++i) {
+    entry_t* leaf = m_top[i].load(std::memory_order_relaxed);
+    if (leaf == nullptr) continue;
+    for (size_t j=0; j!=(size_t(1) << LEAF_BITS); ++j) {
+      uint8_t* data = leaf[j].load(std::memory_order_relaxed);
+      if (data >= m_attached_lo and data < m_attached_hi) continue; //< not ours
+      delete [] data;
+    }
+    delete [] leaf;
+  }
+}
+
+uint8_t* sparse_memory::find(uint64_t index) const
+{
+  entry_t* leaf = m_top[index >> LEAF_BITS].load(std::memory_order_acquire);
+  if (leaf == nullptr) return nullptr;
+  return leaf[index & ((uint64_t(1) << LEAF_BITS) - 1)].load(std::memory_order_acquire);
+}
+
+sparse_memory::entry_t& sparse_memory::entry(uint64_t index)
+{
+  std::atomic<entry_t*>& top(m_top[index >> LEAF_BITS]);
+  entry_t* leaf = top.load(std::memory_order_relaxed);
+  if (leaf == nullptr) {
+    leaf = new entry_t[size_t(1) << LEAF_BITS];
+    for (size_t j=0; j!=(size_t(1) << LEAF_BITS); ++j) leaf[j].store(nullptr, std::memory_order_relaxed);
+    top.store(leaf, std::memory_order_release);
+  }
+  return leaf[index & ((uint64_t(1) << LEAF_BITS) - 1)];
+}
+
+uint8_t* sparse_memory::page(uint64_t address)
+{
+  uint64_t index = address >> m_page_bits;
+  uint8_t* found = cached(index);
+  if (found != nullptr) return found;
+  // First touch: zeroed, then published for peek()
+  found = new uint8_t[page_size()]();
+  entry(index).store(found, std::memory_order_release);
+  ++m_pages_allocated;
+  m_last_index = index;
+  m_last_page  = found;
+  return found;
+}
+
+void sparse_memory::attach(uint64_t index, uint8_t* storage)
+{
+  if (m_attached_lo == nullptr or storage < m_attached_lo) m_attached_lo = storage;
+  if (storage + page_size() > m_attached_hi) m_attached_hi = storage + page_size();
+  entry(index).store(storage, std::memory_order_release);
+  ++m_pages_allocated;
+}
+
+void sparse_memory::read(uint64_t address, uint8_t* data, uint64_t length)
+{
+  while (length != 0) {
+    uint64_t offset = address & (page_size()-1);
+    uint64_t chunk  = std::min(length, page_size() - offset);
+    uint8_t* source = cached(address >> m_page_bits);
+    if (source != nullptr) memcpy(data, source + offset, chunk);
+    else                   memset(data, 0, chunk); //< untouched
+    address += chunk;
+    data    += chunk;
+    length  -= chunk;
+  }//endwhile
+}
+
+void sparse_memory::write(uint64_t address, const uint8_t* data, uint64_t length)
+{
+  while (length != 0) {
+    uint64_t offset = address & (page_size()-1);
+    uint64_t chunk  = std::min(length, page_size() - offset);
+    memcpy(page(address) + offset, data, chunk);
+    address += chunk;
+    data    += chunk;
+    length  -= chunk;
+  }//endwhile
+}
+
+void sparse_memory::read_masked(uint64_t address, uint8_t* data, uint64_t length
+                               , const uint8_t* mask, size_t mask_length, size_t mask_offset)
+{
+  while (length != 0) {
+    uint64_t offset = address & (page_size()-1);
+    uint64_t chunk  = std::min(length, page_size() - offset);
+    const uint8_t* source = cached(address >> m_page_bits);
+    if (source != nullptr) {
+      source += offset;
+    } else {
+      chunk  = std::min<uint64_t>(chunk, sizeof(ZEROS)); //< untouched
+      source = ZEROS;
+    }
+    masked_copy(data, source, chunk, mask, mask_length, mask_offset);
+    address     += chunk;
+    data        += chunk;
+    length      -= chunk;
+    mask_offset += chunk;
+  }//endwhile
+}
+
+void sparse_memory::write_masked(uint64_t address, const uint8_t* data, uint64_t length
+                                , const uint8_t* mask, size_t mask_length, size_t mask_offset)
+{
+  while (length != 0) {
+    uint64_t offset = address & (page_size()-1);
+    uint64_t chunk  = std::min(length, page_size() - offset);
+    masked_copy(page(address) + offset, data, chunk, mask, mask_length, mask_offset);
+    address     += chunk;
+    data        += chunk;
+    length      -= chunk;
+    mask_offset += chunk;
+  }//endwhile
+}
+
+void sparse_memory::peek(uint64_t address, uint8_t* data, uint64_t length) const
+{
+  while (length != 0) {
+    uint64_t offset = address & (page_size()-1);
+    uint64_t chunk  = std::min(length, page_size() - offset);
+    const uint8_t* source = find(address >> m_page_bits);
+    if (source != nullptr) memcpy(data, source + offset, chunk);
+    else                   memset(data, 0, chunk);
+    address += chunk;
+    data    += chunk;
+    length  -= chunk;
+  }//endwhile
+}
@@ -0,0 +1,131 @@
+#ifndef SPARSE_MEMORY_H
+#define SPARSE_MEMORY_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Byte-addressed storage for large, mostly untouched address spaces. Memory
+// is divided into pages that are allocated (zeroed) on first write; reading
+// an untouched page yields zeros without allocating it. Pages are found
+// through a two-level table, and the owner thread remembers the last page it
+// used so that runs of accesses to one page cost a compare and a memcpy.
+//
+// One thread (SystemC) owns the memory: it alone calls page(), read() and
+// write(). Other threads may call peek(); table entries are published with
+// release semantics, so a reader sees either no page or a complete one. The
+// page contents themselves still need the owner's seqlock (see dev_module).
+//
+// Pages may also be attached from elsewhere, e.g. a mapped checkpoint file;
+// those are used in place and never freed by the memory.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+struct sparse_memory
+{
+  explicit sparse_memory(uint64_t size, unsigned page_bits = 12);
+  ~sparse_memory(void);
+  sparse_memory(const sparse_memory&) = delete;
+  sparse_memory& operator=(const sparse_memory&) = delete;
+
+  uint64_t size           (void) const { return m_size; }
+  unsigned page_bits      (void) const { return m_page_bits; }
+  uint64_t page_size      (void) const { return uint64_t(1) << m_page_bits; }
+  uint64_t page_base      (uint64_t address) const { return address & ~(page_size()-1); }
+  size_t   pages_allocated(void) const { return m_pages_allocated; }
+  // Page holding address has been written (or attached); never allocates
+  bool     touched        (uint64_t address) const
+  {
+    uint64_t index = address >> m_page_bits;
+    return index == m_last_index or find(index) != nullptr;
+  }
+
+  // Owner only. Callers check address+length against size().
+  uint8_t* page (uint64_t address); //< page holding address, allocated if new
+  void     read (uint64_t address, uint8_t* data, uint64_t length);
+  void     write(uint64_t address, const uint8_t* data, uint64_t length);
+  // Owner only: as read() and write(), but only the bytes enabled by a TLM
+  // byte enable mask, used as for masked_copy() starting at mask_offset
+  void     read_masked (uint64_t address, uint8_t* data, uint64_t length
+                       , const uint8_t* mask, size_t mask_length, size_t mask_offset);
+  void     write_masked(uint64_t address, const uint8_t* data, uint64_t length
+                       , const uint8_t* mask, size_t mask_length, size_t mask_offset);
+  // Owner only: one value of N bytes at an N-aligned address, so never split
+  // across pages; inline and sized at compile time for register accesses
+  template<unsigned N>
+  void     read_word(uint64_t address, uint8_t* data)
+  {
+    const uint8_t* source = cached(address >> m_page_bits);
+    if (source != nullptr) memcpy(data, source + (address & (page_size()-1)), N);
+    else                   memset(data, 0, N);
+  }
+  template<unsigned N>
+  void     write_word(uint64_t address, const uint8_t* data)
+  {
+    uint8_t* target = (address >> m_page_bits) == m_last_index ? m_last_page : page(address);
+    memcpy(target + (address & (page_size()-1)), data, N);
+  }
+
+  // Any thread; never allocates
+  void     peek (uint64_t address, uint8_t* data, uint64_t length) const;
+
+  // Owner only: use storage owned by the caller (page_size() bytes, kept
+  // alive longer than the memory) as page number index, which must be new
+  void     attach(uint64_t index, uint8_t* storage);
+  // Owner only: visit(page number, data) for every allocated page in order
+  template<typename Visit>
+  void     for_each_page(Visit visit) const
+  {
+    for (uint64_t i=0; i!=m_leaves; ++i) {
+      entry_t* leaf = m_top[i].load(std::memory_order_relaxed);
+      if (leaf == nullptr) continue;
+      for (uint64_t j=0; j!=(uint64_t(1) << LEAF_BITS); ++j) {
+        const uint8_t* data = leaf[j].load(std::memory_order_relaxed);
+        if (data != nullptr) visit((i << LEAF_BITS) + j, data);
+      }
+    }//endfor
+  }
+
+private:
+  typedef std::atomic<uint8_t*> entry_t;
+  static const unsigned LEAF_BITS = 10; //< pages per second-level table: 1024
+  uint8_t* find(uint64_t index) const;  //< page number index, or nullptr
+  entry_t& entry(uint64_t index);       //< table slot, adding its leaf if needed
+  uint8_t* cached(uint64_t index)       //< last page, else find() and remember
+  {
+    if (index != m_last_index) {
+      uint8_t* found = find(index);
+      if (found == nullptr) return nullptr;
+      m_last_index = index;
+      m_last_page  = found;
+    }
+    return m_last_page;
+  }
+  const uint64_t  m_size;
+  const unsigned  m_page_bits;
+  const uint64_t  m_leaves;                       //< first-level entries
+  std::unique_ptr<std::atomic<entry_t*>[]> m_top; //< second-level tables, lazily
+  size_t          m_pages_allocated{0};
+  uint64_t        m_last_index;                   //< page number of m_last_page
+  uint8_t*        m_last_page{nullptr};
+  uint8_t*        m_attached_lo{nullptr};         //< attached pages lie in [lo,hi)
+  uint8_t*        m_attached_hi{nullptr};
+};
+
+#endif /*SPARSE_MEMORY_H*/
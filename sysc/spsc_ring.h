@@ -0,0 +1,112 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Bounded lock-free FIFO between exactly one producer thread and exactly one
+// consumer thread. Capacity is rounded up to a power of two and the storage is
+// one contiguous array allocated at construction. Each index sits on its own
+// cache line together with the owning side's cached copy of the other index,
+// so in steady state neither side touches the other's line except to refresh
+// that copy when the ring looks full (producer) or empty (consumer).
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#ifndef SPSC_CACHE_LINE
+#define SPSC_CACHE_LINE 64
+#endif
+
+template<typename T>
+struct spsc_ring
+{
+  explicit spsc_ring(size_t capacity)
+  : m_mask(round_up(capacity)-1)
+  , m_slots(new T[m_mask+1])
+  {}
+  spsc_ring(const spsc_ring&) = delete;
+  spsc_ring& operator=(const spsc_ring&) = delete;
+
+  // Producer side; false if full (value is then left untouched)
+  bool push(const T& value)
+  {
+    T copy(value);
+    return push(std::move(copy));
+  }
+  bool push(T&& value)
+  {
+    size_t tail = m_producer.index.load(std::memory_order_relaxed);
+    if (tail - m_producer.cached == m_mask+1) {
+      m_producer.cached = m_consumer.index.load(std::memory_order_acquire);
+      if (tail - m_producer.cached == m_mask+1) return false;
+    }
+    m_slots[tail & m_mask] = std::move(value);
+    m_producer.index.store(tail+1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side; false if empty
+  bool pop(T& value)
+  {
+    size_t head = m_consumer.index.load(std::memory_order_relaxed);
+    if (head == m_consumer.cached) {
+      m_consumer.cached = m_producer.index.load(std::memory_order_acquire);
+      if (head == m_consumer.cached) return false;
+    }
+    value = std::move(m_slots[head & m_mask]);
+    m_slots[head & m_mask] = T(); //< drop any reference held by the slot
+    m_consumer.index.store(head+1, std::memory_order_release);
+    return true;
+  }
+
+  // Either side; a snapshot that may be stale by the time it is used
+  bool   empty(void) const
+  {
+    return m_consumer.index.load(std::memory_order_acquire)
+        == m_producer.index.load(std::memory_order_acquire);
+  }
+  size_t size    (void) const
+  {
+    return m_producer.index.load(std::memory_order_acquire)
+         - m_consumer.index.load(std::memory_order_acquire);
+  }
+  size_t capacity(void) const { return m_mask+1; }
+
+private:
+  static size_t round_up(size_t capacity)
+  {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    return size;
+  }
+  // Padded rather than over-aligned so that containing objects still work
+  // with plain operator new under C++11
+  struct side_t {
+    std::atomic<size_t> index{0};  //< next slot this side uses (free-running)
+    size_t              cached{0}; //< last seen index of the other side
+    char                pad[SPSC_CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+  };
+  const size_t         m_mask;
+  std::unique_ptr<T[]> m_slots;
+  char                 m_pad[SPSC_CACHE_LINE]; //< keeps m_producer off the line above
+  side_t               m_producer; //< written only by the producer
+  side_t               m_consumer; //< written only by the consumer
+};
+
+#endif /*SPSC_RING_H*/
@@ -0,0 +1,97 @@
+// FILE: timer_bank.cpp
+
+////////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "timer_bank.h"
+
+using namespace sc_core;
+
+const uint64_t timer_bank::STOPPED; //< bound by reference below
+
+timer_bank::timer_bank(size_t timers, const sc_time& tick)
+: m_tick(tick.value())
+, m_expiry(timers, STOPPED)
+{
+  sc_assert(m_tick != 0);
+}
+
+void timer_bank::load(size_t n, uint64_t count, const sc_time& offset)
+{
+  if (count == 0) {
+    m_expiry[n] = STOPPED;
+    return;
+  }
+  uint64_t now = (sc_time_stamp() + offset).value();
+  // Saturate just short of STOPPED rather than wrap into the past
+  if (now >= STOPPED - 1 or count > (STOPPED - 1 - now) / m_tick) {
+    m_expiry[n] = STOPPED - 1;
+  } else {
+    m_expiry[n] = now + count * m_tick;
+  }
+  // Reloaded timers leave stale entries behind; rebuild once they dominate
+  if (m_pending.size() > 2*m_expiry.size() + 64) {
+    uint64_t current = sc_time_stamp().value();
+    retire(current);
+    std::vector<pending_t> live;
+    for (size_t i=0; i!=m_expiry.size(); ++i) {
+      if (m_expiry[i] != STOPPED and m_expiry[i] > current) live.emplace_back(m_expiry[i], i);
+    }//endfor
+    m_pending = decltype(m_pending)(std::greater<pending_t>(), std::move(live));
+  } else {
+    m_pending.emplace(m_expiry[n], n);
+  }
+  schedule();
+}
+
+uint64_t timer_bank::count(size_t n, const sc_time& offset) const
+{
+  uint64_t now = (sc_time_stamp() + offset).value();
+  if (m_expiry[n] == STOPPED or m_expiry[n] <= now) return 0;
+  return (m_expiry[n] - now - 1) / m_tick + 1; //< rounds up without overflowing
+}
+
+bool timer_bank::expired(size_t n, const sc_time& offset) const
+{
+  return m_expiry[n] != STOPPED and m_expiry[n] <= (sc_time_stamp() + offset).value();
+}
+
+void timer_bank::clear(size_t n, const sc_time& offset)
+{
+  if (expired(n, offset)) m_expiry[n] = STOPPED;
+}
+
+void timer_bank::update(void)
+{
+  retire(sc_time_stamp().value());
+  schedule();
+}
+
+void timer_bank::retire(uint64_t now)
+{
+  while (not m_pending.empty() and m_pending.top().first <= now) {
+    if (m_expiry[m_pending.top().second] == m_pending.top().first) ++m_expirations; //< else reloaded since
+    m_pending.pop();
+  }//endwhile
+}
+
+// The event keeps the earlier of two notifications, so a later expiry never
+// delays an earlier one already scheduled
+void timer_bank::schedule(void)
+{
+  if (m_pending.empty()) return;
+  m_event.notify(sc_time::from_value(m_pending.top().first - sc_time_stamp().value()));
+}
@@ -0,0 +1,65 @@
+#ifndef TIMER_BANK_H
+#define TIMER_BANK_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Countdown timers that are never ticked. Loading a timer records when it
+// will reach zero; its count is worked out from that and sc_time_stamp()
+// only when read. Pending expiries are kept in a heap and a single event is
+// scheduled for the earliest, so an idle or busy bank of any size costs
+// nothing per simulated cycle: loading costs O(log n), and each expiry one
+// process activation (the owner calls update() when expiry_event() fires).
+
+#include <systemc>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+struct timer_bank
+{
+  timer_bank(size_t timers, const sc_core::sc_time& tick);
+
+  // Accesses happen at sc_time_stamp() + offset, the initiator's local
+  // time offset under temporal decoupling
+  size_t   size   (void) const { return m_expiry.size(); }
+  // Start timer n counting down from count ticks (0 stops it); clears its
+  // expired flag. Counts beyond the end of simulated time saturate there
+  void     load   (size_t n, uint64_t count, const sc_core::sc_time& offset = sc_core::SC_ZERO_TIME);
+  uint64_t count  (size_t n, const sc_core::sc_time& offset = sc_core::SC_ZERO_TIME) const; //< ticks left, 0 when stopped or expired
+  bool     expired(size_t n, const sc_core::sc_time& offset = sc_core::SC_ZERO_TIME) const; //< reached zero since loaded
+  void     clear  (size_t n, const sc_core::sc_time& offset = sc_core::SC_ZERO_TIME); //< forget the expiry of timer n
+  // Notified at the earliest pending expiry; update() must then be called
+  const sc_core::sc_event& expiry_event(void) const { return m_event; }
+  void     update (void);           //< drop expired entries, schedule the next
+  uint64_t expirations(void) const { return m_expirations; }
+
+private:
+  typedef std::pair<uint64_t, size_t> pending_t; //< expiry (time value), timer
+  static const uint64_t STOPPED = ~uint64_t(0);
+  void     retire  (uint64_t now);  //< pop entries due by now, counting expiries
+  void     schedule(void);          //< notify m_event for the heap's earliest
+  const uint64_t        m_tick;     //< time value of one count
+  std::vector<uint64_t> m_expiry;   //< time value at which each reaches zero
+  std::priority_queue<pending_t, std::vector<pending_t>, std::greater<pending_t>> m_pending;
+  sc_core::sc_event     m_event;
+  uint64_t              m_expirations{0};
+};
+
+#endif /*TIMER_BANK_H*/
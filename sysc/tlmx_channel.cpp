@@ -17,8 +17,9 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "tlmx_channel.h"
+#include <algorithm>
 #include <thread>
-#include <mutex>
+#include <string>
 #include "report.h"
 
 using namespace std;
@@ -28,138 +29,152 @@ namespace {
   static char const* const MSGID = "/Doulos/example/tlmx_channel";
 }
 
-// Constructor
-tlmx_channel::tlmx_channel(const char* instance_name)
-: m_thread_did_push(false)
-, m_thread_did_pull(false)
-, m_sysc_did_put(false)
+///////////////////////////////////////////////////////////////////////////////
+// Lanes towards SystemC
+tlmx_lane_queue::tlmx_lane_queue(size_t capacity)
 {
-  m_mutex_wait_get.lock();
-  m_mutex_wait_put.lock();
-  REPORT_NOTE("m_mutex_wait_put LOCKED in thread");
-}
-
-// Destructor
-tlmx_channel::~tlmx_channel(void)
-{
-}
-
-void tlmx_channel::push(tlmx_packet_ptr tlmx_payload_ptr)
-{
-  // Lockdown and place in queue
-  std::lock_guard<std::mutex> protect(m_mutex_to_sysc);
-  m_queue_to_sysc.push_front(tlmx_payload_ptr);
-  // Notify SystemC
-  m_thread_did_push = true;
-  async_request_update();
-}
-
-bool tlmx_channel::can_get(void) const
-{
-  // Lockdown and determine status of queue
-  std::lock_guard<std::mutex> protect(m_mutex_to_sysc);
-  return not m_queue_to_sysc.empty();
+  for (int lane=0; lane!=TLMX_LANES; ++lane) {
+    m_lanes[lane].reset(new spsc_ring<tlmx_packet_ptr>(capacity));
+    m_gets[lane] = 0;
+  }
+  set_weights(16, 4, 1);
 }
 
-void tlmx_channel::get(tlmx_packet_ptr& tlmx_payload_ptr)
+void tlmx_lane_queue::set_weights(unsigned urgent, unsigned normal, unsigned bulk)
 {
-  while (not nb_get(tlmx_payload_ptr)) wait(m_sysc_get_event);
+  bool strict = (urgent == 0 and normal == 0 and bulk == 0);
+  m_weight[TLMX_LANE_URGENT] = strict ? 0 : max(1u, urgent);
+  m_weight[TLMX_LANE_NORMAL] = strict ? 0 : max(1u, normal);
+  m_weight[TLMX_LANE_BULK]   = strict ? 0 : max(1u, bulk);
+  for (int lane=0; lane!=TLMX_LANES; ++lane) m_credit[lane] = m_weight[lane];
 }
 
-tlmx_packet_ptr& tlmx_channel::get(void)
+// Highest lane with data that still has credit in this round; a new round
+// starts once every lane with data has used its credit
+bool tlmx_lane_queue::pop(tlmx_packet_ptr& tlmx_payload_ptr)
 {
-  tlmx_packet_ptr* tlmx_payload_ptr = new tlmx_packet_ptr{0};
-  get(*tlmx_payload_ptr);
-  return *tlmx_payload_ptr;
-}
-
-
-bool tlmx_channel::nb_get(tlmx_packet_ptr& tlmx_payload_ptr)
+  bool strict = (m_weight[TLMX_LANE_URGENT] == 0);
+  for (int round=0; round!=2; ++round) {
+    for (int lane=0; lane!=TLMX_LANES; ++lane) {
+      if ((strict or m_credit[lane] != 0) and m_lanes[lane]->pop(tlmx_payload_ptr)) {
+        if (not strict) --m_credit[lane];
+        ++m_gets[lane];
+        return true;
+      }
+    }//endfor
+    if (strict) break;
+    for (int lane=0; lane!=TLMX_LANES; ++lane) m_credit[lane] = m_weight[lane];
+  }//endfor
+  return false;
+}
+
+bool tlmx_lane_queue::empty(void) const
 {
-  // Lockdown and obtain from queue
-  std::lock_guard<std::mutex> protect(m_mutex_to_sysc);
-  if (m_queue_to_sysc.empty()) return false;
-  tlmx_payload_ptr = m_queue_to_sysc.back();
-  m_queue_to_sysc.pop_back();
-  // Release waiting threads
-  m_mutex_wait_get.unlock();
-  m_mutex_wait_get.lock();
+  for (const auto& lane : m_lanes) {
+    if (not lane->empty()) return false;
+  }
   return true;
 }
 
-void tlmx_channel::wait_for_get(void) const
+size_t tlmx_lane_queue::size(void) const
 {
-  m_mutex_wait_get.lock();
-  m_mutex_wait_get.unlock();
+  size_t depth = 0;
+  for (const auto& lane : m_lanes) depth += lane->size();
+  return depth;
 }
 
-void tlmx_channel::nb_put(tlmx_packet_ptr tlmx_payload_ptr)
+void tlmx_lane_queue::report(const string& channel_name) const
 {
-  // Lockdown and push onto queue
-  std::lock_guard<std::mutex> protect(m_mutex_fm_sysc);
-  m_queue_fm_sysc.push_front(tlmx_payload_ptr);
-  tlmx_payload_ptr->print("DEBUG: ");
-  // Notify thread
-  m_sysc_did_put = true;
-  m_mutex_wait_put.unlock();
-  m_mutex_wait_put.lock();
+  REPORT_INFO(channel_name << " requests by lane: " << m_gets[TLMX_LANE_URGENT] << " urgent, "
+           << m_gets[TLMX_LANE_NORMAL] << " normal, " << m_gets[TLMX_LANE_BULK] << " bulk"
+           << (m_weight[TLMX_LANE_URGENT] == 0 ? string(" (strict priority)")
+              : " (weights " + to_string(m_weight[TLMX_LANE_URGENT]) + ":" + to_string(m_weight[TLMX_LANE_NORMAL])
+                + ":" + to_string(m_weight[TLMX_LANE_BULK]) + ")"));
 }
 
-void tlmx_channel::wait_for_put(void) const
-{
-  m_mutex_wait_put.lock();
-  REPORT_NOTE("m_mutex_wait_put LOCKED in thread");
-  m_mutex_wait_put.unlock();
-  REPORT_NOTE("m_mutex_wait_put UNlocked in thread");
-}
-
-bool tlmx_channel::can_pull(void) const
+///////////////////////////////////////////////////////////////////////////////
+// Constructor
+tlmx_channel::tlmx_channel(const char* instance_name)
+: base_type(instance_name)
 {
-  // Lockdown and determine status of queue
-  std::lock_guard<std::mutex> protect(m_mutex_fm_sysc);
-  return not m_queue_fm_sysc.empty();
 }
 
-bool tlmx_channel::nb_pull(tlmx_packet_ptr& tlmx_payload_ptr)
+void tlmx_channel::push(tlmx_packet_ptr tlmx_payload_ptr, tlmx_lane_t lane)
 {
-  // Determine if anything available and wait if need be
-  // Lockdown and obtain from queue
-  std::lock_guard<std::mutex> protect(m_mutex_fm_sysc);
-  if (m_queue_fm_sysc.empty()) return false;
-  tlmx_payload_ptr = m_queue_fm_sysc.back();
-  tlmx_payload_ptr->print("DEBUG: ");
-  m_queue_fm_sysc.pop_back();
-  // Notify SystemC
-  m_thread_did_pull = true;
-  m_sysc_did_put = false;
-  async_request_update();
-  return true;
+  // Place in queue; only full if SystemC holds more than capacity() packets
+  while (not m_queue_to_sysc.push(std::move(tlmx_payload_ptr), lane)) std::this_thread::yield();
+  pushed();
 }
 
-const sc_core::sc_event& tlmx_channel::sysc_put_event(void) const
+void tlmx_channel::set_lane_weights(unsigned urgent, unsigned normal, unsigned bulk)
 {
-  return m_sysc_put_event;
+  m_queue_to_sysc.set_weights(urgent, normal, bulk);
 }
 
-const sc_core::sc_event& tlmx_channel::sysc_get_event(void) const
+void tlmx_channel::end_of_simulation(void)
 {
-  return m_sysc_get_event;
+  base_type::end_of_simulation();
+  m_queue_to_sysc.report(name());
 }
 
-void tlmx_channel::update(void)
+#ifdef TEST_TLMX_CHANNEL
+///////////////////////////////////////////////////////////////////////////////
+// Micro-benchmark: wake-up latency from nb_put() to the return of
+// wait_for_put() in another thread. The putter waits for each packet to be
+// pulled and pauses so the waiter is asleep (or spinning) again before the
+// next put.
+//
+//   usage: tlmx_channel.x [-spin=N] [-count=N] [-gap=USECS]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+int sc_main(int argc, char* argv[])
 {
-  { // Handle push
-    std::lock_guard<std::mutex> protect(m_mutex_to_sysc);
-    if (m_thread_did_push) {
-      m_sysc_put_event.notify(SC_ZERO_TIME);
-      m_thread_did_push = false;
-    }
-  }
-  { // Handle get
-    std::lock_guard<std::mutex> protect(m_mutex_fm_sysc);
-    if (m_thread_did_pull) {
-      m_sysc_get_event.notify(SC_ZERO_TIME);
-      m_thread_did_pull = false;
-    }
-  }
-}
+  unsigned spin{0}, count{100000}, gap_us{20};
+  for (int i=1; i<argc; ++i) {
+    string arg(argv[i]);
+    if      (arg.find("-spin=")  == 0) spin   = atoi(arg.substr(6).c_str());
+    else if (arg.find("-count=") == 0) count  = max(1,atoi(arg.substr(7).c_str()));
+    else if (arg.find("-gap=")   == 0) gap_us = atoi(arg.substr(5).c_str());
+  }//endfor
+  typedef std::chrono::steady_clock clock;
+  tlmx_channel channel("channel");
+  channel.set_spin(spin);
+  uint8_t data[TLMX_MAX_DATA_LEN];
+  tlmx_packet_ptr packet(new tlmx_packet( TLMX_IGNORE, 0, 0, data ));
+  std::atomic<int64_t>  stamp{0};   //< nanoseconds at nb_put
+  std::atomic<unsigned> pulled{0};
+  vector<int64_t>       latency(count);
+
+  std::thread waiter([&]{
+    tlmx_packet_ptr received;
+    for (unsigned i=0; i!=count; ++i) {
+      for (;;) {
+        uint32_t seen = channel.put_sequence();
+        if (channel.nb_pull(received)) break;
+        channel.wait_for_put(seen);
+      }//endfor
+      latency[i] = clock::now().time_since_epoch().count() - stamp.load();
+      pulled.store(i+1, std::memory_order_release);
+    }//endfor
+  });
+  for (unsigned i=0; i!=count; ++i) {
+    std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+    stamp.store(clock::now().time_since_epoch().count());
+    channel.nb_put(packet);
+    while (pulled.load(std::memory_order_acquire) != i+1) std::this_thread::yield();
+  }//endfor
+  waiter.join();
+
+  sort(latency.begin(), latency.end());
+  auto percentile = [&](double p) { return latency[size_t(p*(count-1))] / 1000.0; };
+  printf("nb_put -> wait_for_put wake-up latency, %u samples, spin=%u, gap=%uus\n", count, spin, gap_us);
+  printf("  p50 %8.2f us\n  p90 %8.2f us\n  p99 %8.2f us\n  p99.9 %6.2f us\n  max %8.2f us\n"
+        , percentile(0.50), percentile(0.90), percentile(0.99), percentile(0.999), percentile(1.0));
+  return 0;
+}
+#endif /*TEST_TLMX_CHANNEL*/
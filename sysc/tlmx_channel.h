@@ -3,47 +3,51 @@
 
 #include "async_thread_if.h"
 #include "async_sysc_if.h"
-#include <list>
-#include <mutex>
+#include "async_channel.h"
+#include "spsc_ring.h"
+#include <memory>
+
+// Queue from the thread to SystemC in tlmx_channel: one ring per tlmx_lane_t.
+// pop() takes requests in strict priority order or, with weights, round robin
+// giving each lane up to its weight of requests per round, so bulk traffic
+// cannot hold up control accesses queued behind it. Order is kept only within
+// a lane; callers that need order across lanes must keep related requests in
+// the same lane.
+struct tlmx_lane_queue
+{
+  explicit tlmx_lane_queue(size_t capacity);
+  bool   push(tlmx_packet_ptr&& tlmx_payload_ptr) { return push(std::move(tlmx_payload_ptr), tlmx_lane_of(*tlmx_payload_ptr)); }
+  bool   push(tlmx_packet_ptr&& tlmx_payload_ptr, tlmx_lane_t lane) { return m_lanes[lane]->push(std::move(tlmx_payload_ptr)); }
+  bool   pop(tlmx_packet_ptr& tlmx_payload_ptr);
+  bool   empty(void) const;
+  size_t size(void) const;
+  size_t capacity(void) const { return m_lanes[0]->capacity(); } //< per lane
+  // Weighted round robin between lanes; strict priority if every weight is 0
+  void   set_weights(unsigned urgent, unsigned normal, unsigned bulk);
+  void   report(const std::string& channel_name) const;
+private:
+  std::unique_ptr<spsc_ring<tlmx_packet_ptr>> m_lanes[TLMX_LANES];
+  unsigned m_weight[TLMX_LANES]; //< all 0 for strict priority
+  unsigned m_credit[TLMX_LANES]; //< left in this round
+  uint64_t m_gets[TLMX_LANES];   //< requests taken per lane
+};
 
 // Implements a channel to interface from a thread to SystemC. To clarify
 // notation of who does what, we use push/pull from the thread side and
 // put/get from the systemc side. Notice the interfaces separate the two
-// sides (SystemC vs asynchronous thread).
+// sides (SystemC vs asynchronous thread). This is async_channel carrying
+// tlmx_packet_ptr, with an eventfd for the thread's event loop and priority
+// lanes towards SystemC; exactly one OS thread may use the thread side.
 struct tlmx_channel
-: sc_core::sc_prim_channel
-, virtual async_sysc_if
+: async_channel<tlmx_packet_ptr, 1024, async_notify_eventfd, tlmx_lane_queue>
 , virtual async_thread_if
 {
-  tlmx_channel(const char* instance_name);
-  ~tlmx_channel(void);
-  void             push         (tlmx_packet_ptr  tlmx_payload_ptr) override;
-  bool             can_get      (void) const override;
-  bool             nb_get       (tlmx_packet_ptr& tlmx_payload_ptr) override;
-  void             get          (tlmx_packet_ptr& tlmx_payload_ptr) override;
-  tlmx_packet_ptr& get          (void) override;
-  void             wait_for_get (void) const override;
-  void             nb_put       (tlmx_packet_ptr tlmx_payload_ptr) override;
-  // Put never blocks because unbounded queue
-  void             wait_for_put (void) const override;
-  bool             can_pull     (void) const override;
-  bool             nb_pull      (tlmx_packet_ptr& tlmx_payload_ptr) override;
-  const sc_core::sc_event& default_event(void) const override { return sysc_put_event(); }
-  const sc_core::sc_event& sysc_put_event(void) const override;
-  const sc_core::sc_event& sysc_get_event(void) const override;
-  void update(void) override;
-private:
-  std::list<tlmx_packet_ptr> m_queue_to_sysc;   //< data from thread
-  bool                       m_thread_did_push; //< indicates push to above
-  std::list<tlmx_packet_ptr> m_queue_fm_sysc;   //< data from systemc
-  bool                       m_sysc_did_put;    //< indicates push to above
-  bool                       m_thread_did_pull; //< indicates get from above
-  sc_core::sc_event          m_sysc_put_event;  //< indicates thread put
-  sc_core::sc_event          m_sysc_get_event;  //< indicates thread put
-  mutable std::mutex         m_mutex_to_sysc;   //< locks shared structures
-  mutable std::mutex         m_mutex_fm_sysc;   //< locks shared structures
-  mutable std::mutex         m_mutex_wait_get;  //< wait for this
-  mutable std::mutex         m_mutex_wait_put;  //< wait for this
+  typedef async_channel<tlmx_packet_ptr, 1024, async_notify_eventfd, tlmx_lane_queue> base_type;
+  explicit tlmx_channel(const char* instance_name);
+  using base_type::push;
+  void push             (tlmx_packet_ptr tlmx_payload_ptr, tlmx_lane_t lane) override;
+  void set_lane_weights (unsigned urgent, unsigned normal, unsigned bulk);
+  void end_of_simulation(void) override;
 };
 
 #endif /*TLMX_CHANNEL_H*/
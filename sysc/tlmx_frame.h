@@ -0,0 +1 @@
+../include/tlmx_frame.h
\ No newline at end of file
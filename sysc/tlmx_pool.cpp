@@ -0,0 +1,65 @@
+// FILE: tlmx_pool.cpp
+
+////////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "tlmx_pool.h"
+
+tlmx_packet_pool::tlmx_packet_pool(size_t capacity)
+: m_data(new uint8_t[capacity*TLMX_MAX_DATA_LEN]())
+, m_slots(capacity)
+{
+  m_free.reserve(capacity);
+  for (size_t i=capacity; i!=0; --i) {
+    slot_t& slot(m_slots[i-1]);
+    slot.packet = tlmx_packet_ptr(new tlmx_packet( TLMX_IGNORE, 0, 0, &m_data[(i-1)*TLMX_MAX_DATA_LEN] ));
+    m_free.push_back(&slot);
+  }
+}
+
+tlmx_packet_pool::slot_t* tlmx_packet_pool::acquire(void)
+{
+  if (m_free.empty()) return nullptr;
+  slot_t* slot = m_free.back();
+  m_free.pop_back();
+  size_t index = slot - &m_slots[0];
+  slot->posted           = false;
+  slot->packet->command  = TLMX_IGNORE;
+  slot->packet->status   = TLMX_INCOMPLETE_RESPONSE;
+  slot->packet->address  = 0;
+  slot->packet->data_len = 0;
+  slot->packet->data_ptr = &m_data[index*TLMX_MAX_DATA_LEN]; //< in case it was redirected
+  return slot;
+}
+
+void tlmx_packet_pool::release(slot_t* slot)
+{
+  m_free.push_back(slot);
+}
+
+// Packets are identified by the payload storage they were given; this needs no
+// lookup table and so no allocation.
+tlmx_packet_pool::slot_t* tlmx_packet_pool::find(const tlmx_packet& packet) const
+{
+  const uint8_t* base = m_data.get();
+  if (packet.data_ptr < base or packet.data_ptr >= base + m_slots.size()*TLMX_MAX_DATA_LEN) {
+    return nullptr;
+  }
+  size_t index = (packet.data_ptr - base) / TLMX_MAX_DATA_LEN;
+  return const_cast<slot_t*>(&m_slots[index]);
+}
+
+//EOF
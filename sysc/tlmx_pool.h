@@ -0,0 +1,53 @@
+#ifndef TLMX_POOL_H
+#define TLMX_POOL_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Preallocated tlmx packets for the adaptor's OS thread. Each slot owns a
+// packet, the payload storage its data_ptr refers to, and the routing of the
+// request it currently carries. Packets travel through the channel to SystemC
+// and back, and return to the pool once their response is sent, so the
+// request path never allocates. Acquire and release both happen on the OS
+// thread; no locking is needed.
+
+#include "tlmx_frame.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct tlmx_packet_pool
+{
+  struct slot_t {
+    tlmx_packet_ptr packet;
+    uint64_t        connection{0}; //< where the response goes
+    tlmx_tag_t      tag{0};        //< returned with the response
+    bool            posted{false}; //< already acknowledged (posted write)
+  };
+  explicit tlmx_packet_pool(size_t capacity);
+  slot_t*     acquire(void);                         //< reset slot or nullptr if exhausted
+  void        release(slot_t* slot);
+  slot_t*     find(const tlmx_packet& packet) const; //< slot owning packet or nullptr
+  size_t      available(void) const { return m_free.size(); }
+  size_t      capacity(void) const { return m_slots.size(); }
+private:
+  std::unique_ptr<uint8_t[]> m_data;  //< TLMX_MAX_DATA_LEN bytes per slot
+  std::vector<slot_t>        m_slots;
+  std::vector<slot_t*>       m_free;  //< stack of unused slots (never grows)
+};
+
+#endif /*TLMX_POOL_H*/
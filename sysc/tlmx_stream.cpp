@@ -0,0 +1,172 @@
+// FILE: tlmx_stream.cpp
+
+////////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "tlmx_stream.h"
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace {
+  // Smallest power of two that holds at least capacity (and one max frame)
+  size_t ring_size(size_t capacity)
+  {
+    size_t size = 1;
+    while (size < capacity or size < size_t(TLMX_MAX_FRAME)) size <<= 1;
+    return size;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reader
+tlmx_frame_reader::tlmx_frame_reader(size_t capacity)
+: m_ring(new char[ring_size(capacity)])
+, m_mask(ring_size(capacity)-1)
+{
+}
+
+int tlmx_frame_reader::fill(int fd)
+{
+  size_t size  = m_mask+1;
+  size_t space = size - buffered();
+  if (space == 0) {
+    errno = ENOBUFS;
+    return -1;
+  }
+  // Free space may wrap the end of the ring
+  size_t tail = m_tail & m_mask;
+  size_t first = std::min(space, size - tail);
+  iovec iov[2];
+  iov[0].iov_base = &m_ring[tail];
+  iov[0].iov_len  = first;
+  iov[1].iov_base = &m_ring[0];
+  iov[1].iov_len  = space - first;
+  ssize_t recv_count = readv(fd, iov, iov[1].iov_len ? 2 : 1);
+  if (recv_count > 0) m_tail += recv_count;
+  return int(recv_count);
+}
+
+size_t tlmx_frame_reader::append(const char* data, size_t size)
+{
+  size_t count = std::min(size, (m_mask+1) - buffered());
+  size_t tail  = m_tail & m_mask;
+  size_t first = std::min(count, (m_mask+1) - tail);
+  memcpy(&m_ring[tail], data, first);
+  memcpy(&m_ring[0], data+first, count-first);
+  m_tail += count;
+  return count;
+}
+
+char* tlmx_frame_reader::peek(int& frame_size)
+{
+  if (buffered() < size_t(TLMX_FRAME_HEADER_SIZE)) return nullptr;
+  size_t head  = m_head & m_mask;
+  size_t first = (m_mask+1) - head; //< contiguous bytes before wrap
+  char header[TLMX_FRAME_HEADER_SIZE];
+  const char* header_ptr = &m_ring[head];
+  if (first < size_t(TLMX_FRAME_HEADER_SIZE)) {
+    memcpy(header, &m_ring[head], first);
+    memcpy(header+first, &m_ring[0], TLMX_FRAME_HEADER_SIZE-first);
+    header_ptr = header;
+  }
+  frame_size = tlmx_frame_size(header_ptr);
+  if (not tlmx_frame_size_ok(frame_size)) {
+    m_corrupt = true;
+    return nullptr;
+  }
+  if (buffered() < size_t(frame_size)) return nullptr; //< rest still in transit
+  if (first >= size_t(frame_size)) return &m_ring[head];
+  // Reassemble a frame that wraps the end of the ring
+  memcpy(m_scratch, &m_ring[head], first);
+  memcpy(m_scratch+first, &m_ring[0], frame_size-first);
+  return m_scratch;
+}
+
+void tlmx_frame_reader::consume(int frame_size)
+{
+  m_head += frame_size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Writer
+tlmx_frame_writer::tlmx_frame_writer(size_t capacity)
+: m_ring(new char[ring_size(capacity)])
+, m_mask(ring_size(capacity)-1)
+{
+}
+
+char* tlmx_frame_writer::reserve(void)
+{
+  size_t size = m_mask+1;
+  if (size - pending() < size_t(TLMX_MAX_FRAME)) return nullptr;
+  size_t tail = m_tail & m_mask;
+  m_staged = (size - tail < size_t(TLMX_MAX_FRAME));
+  return m_staged ? m_scratch : &m_ring[tail];
+}
+
+void tlmx_frame_writer::commit(int frame_size)
+{
+  if (m_staged) {
+    size_t tail  = m_tail & m_mask;
+    size_t first = std::min(size_t(frame_size), (m_mask+1) - tail);
+    memcpy(&m_ring[tail], m_scratch, first);
+    memcpy(&m_ring[0], m_scratch+first, frame_size-first);
+    m_staged = false;
+  }
+  m_tail += frame_size;
+}
+
+int tlmx_frame_writer::gather(iovec iov[2]) const
+{
+  if (empty()) return 0;
+  size_t head  = m_head & m_mask;
+  size_t first = std::min(pending(), (m_mask+1) - head);
+  iov[0].iov_base = &m_ring[head];
+  iov[0].iov_len  = first;
+  iov[1].iov_base = &m_ring[0];
+  iov[1].iov_len  = pending() - first;
+  return iov[1].iov_len ? 2 : 1;
+}
+
+void tlmx_frame_writer::sent(size_t count)
+{
+  m_head += count;
+}
+
+// sendmsg rather than writev for MSG_NOSIGNAL: a client that has gone away
+// yields EPIPE for its own connection instead of a process-wide SIGPIPE
+int tlmx_frame_writer::flush(int fd)
+{
+  iovec iov[2];
+  while (int segments = gather(iov)) {
+    msghdr message{};
+    message.msg_iov    = iov;
+    message.msg_iovlen = segments;
+    ssize_t send_count = sendmsg(fd, &message, MSG_NOSIGNAL);
+    if (send_count < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN or errno == EWOULDBLOCK) break; //< wait for EPOLLOUT
+      return -1;
+    }
+    sent(send_count);
+  }
+  return int(pending());
+}
+
+//EOF
@@ -0,0 +1,72 @@
+#ifndef TLMX_STREAM_H
+#define TLMX_STREAM_H
+
+///////////////////////////////////////////////////////////////////////////////
+// $License: Apache 2.0 $
+//
+// This file is licensed under the Apache License, Version 2.0 (the "License").
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Buffered reading and writing of tlmx frames (see tlmx_frame.h) on a stream
+// socket. Both sides keep their bytes in a power-of-two ring so that positions
+// wrap with a mask and no data is ever shuffled down.
+
+#include "tlmx_frame.h"
+#include <cstddef>
+#include <memory>
+#include <sys/uio.h>
+
+// Collects bytes from a socket and hands back whole frames. One recv may
+// deliver several frames, or only part of one; the remainder stays buffered
+// until the rest arrives.
+struct tlmx_frame_reader
+{
+  explicit tlmx_frame_reader(size_t capacity = 64*1024);
+  int         fill(int fd);               //< one readv: bytes read, 0 at EOF, -1 on error
+  size_t      append(const char* data, size_t size); //< copy in bytes received elsewhere; returns count taken
+  char*       peek(int& frame_size);      //< next whole frame or nullptr
+  void        consume(int frame_size);    //< release frame returned by peek
+  bool        corrupt(void) const { return m_corrupt; }
+  size_t      buffered(void) const { return m_tail - m_head; }
+private:
+  std::unique_ptr<char[]> m_ring;
+  size_t                  m_mask;
+  size_t                  m_head{0};      //< next byte to consume (free-running)
+  size_t                  m_tail{0};      //< next byte to fill (free-running)
+  bool                    m_corrupt{false};
+  char                    m_scratch[TLMX_MAX_FRAME]; //< frame that wraps the ring
+};
+
+// Accumulates outgoing frames and sends everything queued with a single sendmsg
+// (two segments when the data wraps the ring).
+struct tlmx_frame_writer
+{
+  explicit tlmx_frame_writer(size_t capacity = 64*1024);
+  char*       reserve(void);              //< room for one TLMX_MAX_FRAME or nullptr if full
+  void        commit(int frame_size);     //< queue frame written at reserve()
+  int         flush(int fd);              //< write what the socket takes; -1 on error
+  int         gather(iovec iov[2]) const; //< segments of pending bytes (0..2) for an external send
+  void        sent(size_t count);         //< release bytes sent via gather()
+  bool        empty(void) const { return m_head == m_tail; }
+  size_t      pending(void) const { return m_tail - m_head; }
+  size_t      capacity(void) const { return m_mask+1; }
+private:
+  std::unique_ptr<char[]> m_ring;
+  size_t                  m_mask;
+  size_t                  m_head{0};      //< next byte to send (free-running)
+  size_t                  m_tail{0};      //< next byte to queue (free-running)
+  bool                    m_staged{false};//< reserve() handed out m_scratch
+  char                    m_scratch[TLMX_MAX_FRAME];
+};
+
+#endif /*TLMX_STREAM_H*/
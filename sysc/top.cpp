@@ -60,6 +60,8 @@ top_module::top_module(sc_module_name instance_name)
 {
   // Connectivity
   async_adaptor_instance->initiator_socket(dev_instance->target_socket);
+  async_adaptor_instance->debug_port(*dev_instance);
+  async_adaptor_instance->set_start_time(dev_instance->restored_time());
 
   // Register processes
   SC_HAS_PROCESS(top_module);
@@ -14,13 +14,20 @@
 // limitations under the License.
 ////////////////////////////////////////////////////////////////////////////////
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /*< syscall() and ftruncate() for tlmx_shm.h */
+#endif
 #include "driver.h"
 #include "tlmx_packet.h"
+#include "tlmx_frame.h"
+#include "tlmx_shm.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <sys/errno.h>
 #include <arpa/inet.h>
 #include <signal.h>
@@ -42,6 +49,7 @@ static pthread_t          server_id; // identifies the server thread
 static int                server_exitcode = 0;
 static int                outgoing_socket;
 static struct sockaddr_in systemc_server;
+static char               unix_path[DEV_UNIX_PATH_MAX]; /*< non-empty selects AF_UNIX */
 static int                interrupt_flag  = 0;
 static pthread_mutex_t    interrupt_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t     interrupt_cond  = PTHREAD_COND_INITIALIZER;
@@ -51,12 +59,75 @@ static pthread_cond_t     server_cond     = PTHREAD_COND_INITIALIZER;
 static int                server_stop     = 0; //< indicates server should stop
 static const char*        acknowledgement = "Ack\n";
 
+/* Requests issued to SystemC but not yet completed by the caller */
+typedef struct {
+  int          busy;       /*< slot holds a request */
+  int          done;       /*< response received */
+  dev_tag_t    tag;
+  tlmx_packet* request;
+  int          status;     /*< 0=SUCCESS; -1=FAILURE */
+  char         frame[TLMX_MAX_FRAME]; /*< request as sent */
+} dev_pending_t;
+static dev_pending_t      pending[DEV_MAX_OUTSTANDING];
+static dev_tag_t          next_tag = 0;
+
+/* Requests retired to free a slot for a newer one before the caller completed
+ * them; their status waits here for dev_complete() or dev_complete_all() */
+typedef struct {
+  dev_tag_t    tag;
+  int          status;
+} dev_retired_t;
+static dev_retired_t*     retired          = NULL;
+static size_t             retired_count    = 0;
+static size_t             retired_capacity = 0;
+
+/* Requests packed but not yet written; sent together by dev_flush() */
+static struct iovec       send_iov[DEV_MAX_OUTSTANDING];
+static int                send_iov_count = 0;
+
+/* Responses received but not yet filed; a ring so partial frames stay put */
+#define DEV_RECV_RING     (2*DEV_MAX_OUTSTANDING*TLMX_MAX_FRAME)
+static char               recv_ring[DEV_RECV_RING];
+static unsigned long      recv_head = 0; /*< next byte to consume (free-running) */
+static unsigned long      recv_tail = 0; /*< next byte to fill (free-running) */
+static char               recv_scratch[TLMX_MAX_FRAME]; /*< frame wrapping the ring */
+
+/* Same-host shared memory transport (hostname "shm:NAME"); replaces the socket */
+static tlmx_shm_t*        shm = NULL;
+
+/* Batch being assembled by dev_batch_*(); records laid out per tlmx_frame.h */
+#define DEV_MAX_BATCH_OPS (TLMX_MAX_DATA_LEN/TLMX_BATCH_OP_HEADER_SIZE)
+typedef struct {
+  data_t* data_ptr; /*< caller's buffer (read data copied back here) */
+  int     offset;   /*< record position within batch_data */
+} dev_batch_op_t;
+static data_t             batch_data[TLMX_MAX_DATA_LEN];
+static dev_batch_op_t     batch_op[DEV_MAX_BATCH_OPS];
+static int                batch_used   = 0; /*< bytes of batch_data in use */
+static int                batch_count  = 0; /*< operations in batch_data */
+static int                batch_status = 0; /*< failures from pieces already sent */
+
+//------------------------------------------------------------------------------
+// Same-host connections may use AF_UNIX sockets instead of TCP/IP: the SystemC
+// server listens at unix_path and the interrupt server at unix_path.irq.
+//------------------------------------------------------------------------------
+static socklen_t dev_unix_address(struct sockaddr_un* addr, const char* suffix)
+{
+  memset(addr,0,sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  snprintf(addr->sun_path,sizeof(addr->sun_path),"%s%s",unix_path,suffix);
+  return (socklen_t)sizeof(*addr);
+}/*end dev_unix_address(...)*/
+
 //------------------------------------------------------------------------------
-void *interrupt_server(void* arg) /*< watches for "interrupt" on TCPIP PORT+1 */
+void *interrupt_server(void* arg) /*< watches for "interrupt" on TCPIP PORT+1 (or unix_path.irq) */
 {
   const char* MSGID = "/Doulos/example/interrupt_server";
   int listening_socket, incoming_socket;
   struct sockaddr_in local_server, remote_client;
+  struct sockaddr_un local_unix;
+  struct sockaddr*   local_address = (struct sockaddr *)&local_server;
+  socklen_t          local_address_len = sizeof(local_server);
   int addr_len;
   int option_value;
   static int server_retval = 0; //< static to aid debug
@@ -69,7 +140,7 @@ void *interrupt_server(void* arg) /*< watches for "interrupt" on TCPIP PORT+1 */
   REPORT_INFO("Starting %s\n",__func__);
 
   /* Create socket */
-  listening_socket = socket(AF_INET, SOCK_STREAM, 0);
+  listening_socket = socket(unix_path[0] ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
   if (listening_socket == -1) {
     REPORT_ERROR("Could not create socket\n");
     server_exitcode = 1;
@@ -77,10 +148,16 @@ void *interrupt_server(void* arg) /*< watches for "interrupt" on TCPIP PORT+1 */
   }
   REPORT_INFO("Opened listening socket\n");
 
-  /* Prepare the sockaddr_in structure */
-  local_server.sin_family = AF_INET;
-  local_server.sin_addr.s_addr = INADDR_ANY;
-  local_server.sin_port = htons( tcpip_port+1 );
+  /* Prepare the sockaddr structure */
+  if (unix_path[0]) {
+    local_address_len = dev_unix_address(&local_unix,".irq");
+    local_address     = (struct sockaddr *)&local_unix;
+    unlink(local_unix.sun_path); /*< left over from an earlier run */
+  } else {
+    local_server.sin_family = AF_INET;
+    local_server.sin_addr.s_addr = INADDR_ANY;
+    local_server.sin_port = htons( tcpip_port+1 );
+  }
 
   option_value = 1;
   if ( setsockopt
@@ -99,8 +176,8 @@ void *interrupt_server(void* arg) /*< watches for "interrupt" on TCPIP PORT+1 */
   /* Bind */
   if ( bind
        ( listening_socket
-       , (struct sockaddr *)&local_server 
-       , sizeof(local_server)
+       , local_address
+       , local_address_len
        ) < 0
   ) {
     REPORT_ERROR("bind failed\n");
@@ -131,8 +208,8 @@ void *interrupt_server(void* arg) /*< watches for "interrupt" on TCPIP PORT+1 */
     REPORT_INFO("Waiting for incoming connections...\n");/**/
     addr_len = sizeof(struct sockaddr_in);
     incoming_socket = accept( listening_socket
-                            , (struct sockaddr *)&remote_client
-                            , (socklen_t*)&addr_len
+                            , unix_path[0] ? NULL : (struct sockaddr *)&remote_client
+                            , unix_path[0] ? NULL : (socklen_t*)&addr_len
                             );
     if (incoming_socket<0) {
       REPORT_ERROR("Accept failed => %s\n",strerror(errno));
@@ -170,6 +247,8 @@ void *interrupt_server(void* arg) /*< watches for "interrupt" on TCPIP PORT+1 */
     assert(send_count == ack_size);
     close(incoming_socket);
   }/*endforever*/
+  close(listening_socket);
+  if (unix_path[0]) unlink(local_unix.sun_path);
   server_exitcode = 0;
   pthread_exit(&server_exitcode);
   //return
@@ -186,55 +265,85 @@ void dev_open(char* hostname, int port)
    * Setup outgoing TCPIP connection
    *****************************************************************************
    */
-  struct hostent*  hostentry;
-  struct in_addr** addr_list;
+  struct hostent*    hostentry;
+  struct in_addr**   addr_list;
+  struct sockaddr_un unix_server;
+  struct sockaddr*   server_address = (struct sockaddr *)&systemc_server;
+  socklen_t          server_address_len = sizeof(systemc_server);
   if (hostname == NULL || hostname[0] == '\0') { hostname = "localhost"; }
   tcpip_port = 4000;
   if (port != 0) tcpip_port = port;
 
-  /* Find the host */
-  if ((hostentry = gethostbyname( hostname )) == NULL) {
-    /* failed */
-    REPORT_ERROR("Failed to gethostbyname => %s\n",strerror(errno));
-    exit(1);
-  }
-  addr_list = (struct in_addr **) hostentry->h_addr_list;
-  for (int i=0; addr_list[i] != NULL; ++i) {
-    strcpy( hostip, inet_ntoa(*addr_list[i]) );
+  if (strncmp(hostname,"shm:",4) == 0) {
+    /* Same host: shared memory segment created by the simulator (see -shm=) */
+    int tries = 0;
+    while ((shm = tlmx_shm_attach(hostname+4)) == NULL) {
+      if (errno != ENOENT) {
+        REPORT_ERROR("Unable to attach shared memory %s => %s\n",hostname+4,strerror(errno));
+        exit(1);
+      }
+      if (++tries%5 == 1) {
+        REPORT_INFO("Waiting for connection - start SystemC?\n");/**/
+      }
+      sleep(1);
+    }
+    REPORT_INFO("Connected\n");
+  } else if (hostname[0] == '/') {
+    /* Same host: path of the simulator's AF_UNIX socket (see -socket=) */
+    if (strlen(hostname) >= DEV_UNIX_PATH_MAX) {
+      REPORT_ERROR("Socket path too long: %s\n",hostname);
+      exit(1);
+    }
+    strcpy( unix_path, hostname );
+    server_address_len = dev_unix_address(&unix_server,"");
+    server_address     = (struct sockaddr *)&unix_server;
+  } else {
+    /* Find the host */
+    if ((hostentry = gethostbyname( hostname )) == NULL) {
+      /* failed */
+      REPORT_ERROR("Failed to gethostbyname => %s\n",strerror(errno));
+      exit(1);
+    }
+    addr_list = (struct in_addr **) hostentry->h_addr_list;
+    for (int i=0; addr_list[i] != NULL; ++i) {
+      strcpy( hostip, inet_ntoa(*addr_list[i]) );
+    }
+    systemc_server.sin_addr.s_addr = inet_addr(hostip);
+    systemc_server.sin_family = AF_INET;
+    systemc_server.sin_port = htons( tcpip_port );
   }
 
   /* Open the socket */
-  outgoing_socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (shm == NULL) {
+    outgoing_socket = socket(server_address->sa_family, SOCK_STREAM, 0);
 
-  if (outgoing_socket == -1) {
-    REPORT_ERROR("Could not create socket => %s\n",strerror(errno));
-  }
-  systemc_server.sin_addr.s_addr = inet_addr(hostip);
-  systemc_server.sin_family = AF_INET;
-  systemc_server.sin_port = htons( tcpip_port );
-  /* Connect to host server */
-  int connect_status = 0;
-  int tries = 0;
-  do {
-    ++tries;
-    connect_status = connect(outgoing_socket, (struct sockaddr *)&systemc_server, sizeof(systemc_server));
-    if (connect_status < 0) {
-      if (errno == ECONNREFUSED)
-      {
-        if (tries%5 == 1) 
+    if (outgoing_socket == -1) {
+      REPORT_ERROR("Could not create socket => %s\n",strerror(errno));
+    }
+    /* Connect to host server */
+    int connect_status = 0;
+    int tries = 0;
+    do {
+      ++tries;
+      connect_status = connect(outgoing_socket, server_address, server_address_len);
+      if (connect_status < 0) {
+        if (errno == ECONNREFUSED || errno == ENOENT) /*< ENOENT: AF_UNIX socket not yet created */
         {
-          REPORT_INFO("Waiting for connection - start SystemC?\n");/**/
+          if (tries%5 == 1) 
+          {
+            REPORT_INFO("Waiting for connection - start SystemC?\n");/**/
+          }
+          sleep(1);
+        }
+        else
+        {
+          REPORT_ERROR("%d %s\n",errno,strerror(errno));
+          exit(1);
         }
-        sleep(1);
-      }
-      else
-      {
-        REPORT_ERROR("%d %s\n",errno,strerror(errno));
-        exit(1);
       }
-    }
-  } while (connect_status < 0 && errno == ECONNREFUSED);
-  REPORT_INFO("Connected\n");
+    } while (connect_status < 0 && (errno == ECONNREFUSED || errno == ENOENT));
+    REPORT_INFO("Connected\n");
+  }/*endif*/
 
   /*
    *****************************************************************************
@@ -276,36 +385,45 @@ void dev_soft_interrupt(const char* irq_message) /*< send a software interrupt*/
   const char* const hostname = "localhost";
   char              ack_reply[TLMX_MAX_BUFFER];
   int               interrupt_socket;
+  struct sockaddr_in interrupt_server_inet;
+  struct sockaddr_un interrupt_server_unix;
+  struct sockaddr*   server_address = (struct sockaddr *)&interrupt_server_inet;
+  socklen_t          server_address_len = sizeof(interrupt_server_inet);
   if (irq_message == NULL) {
     irq_message = "Software interrupt\n";
   }
 
-  /* Find the host */
-  if ((hostentry = gethostbyname( hostname )) == NULL) {
-    /* failed */
-    REPORT_ERROR("Failed to gethostbyname => %s\n",strerror(errno));
-    exit(1);
-  }
-  addr_list = (struct in_addr **) hostentry->h_addr_list;
-  for (int i=0; addr_list[i] != NULL; ++i) {
-    strcpy( hostip, inet_ntoa(*addr_list[i]) );
+  if (unix_path[0]) {
+    server_address_len = dev_unix_address(&interrupt_server_unix,".irq");
+    server_address     = (struct sockaddr *)&interrupt_server_unix;
+  } else {
+    /* Find the host */
+    if ((hostentry = gethostbyname( hostname )) == NULL) {
+      /* failed */
+      REPORT_ERROR("Failed to gethostbyname => %s\n",strerror(errno));
+      exit(1);
+    }
+    addr_list = (struct in_addr **) hostentry->h_addr_list;
+    for (int i=0; addr_list[i] != NULL; ++i) {
+      strcpy( hostip, inet_ntoa(*addr_list[i]) );
+    }
+    interrupt_server_inet.sin_addr.s_addr = inet_addr(hostip);
+    interrupt_server_inet.sin_family = AF_INET;
+    interrupt_server_inet.sin_port = htons( tcpip_port+1 );
   }
 
   /* Open the socket */
-  interrupt_socket = socket(AF_INET, SOCK_STREAM, 0);
+  interrupt_socket = socket(server_address->sa_family, SOCK_STREAM, 0);
 
   if (interrupt_socket == -1) {
     REPORT_ERROR("Could not create socket => %s\n",strerror(errno));
   }
-  systemc_server.sin_addr.s_addr = inet_addr(hostip);
-  systemc_server.sin_family = AF_INET;
-  systemc_server.sin_port = htons( tcpip_port+1 );
   /* Connect to host server */
   int connect_status = 0;
   int tries = 0;
   do {
     ++tries;
-    connect_status = connect(interrupt_socket, (struct sockaddr *)&systemc_server, sizeof(systemc_server));
+    connect_status = connect(interrupt_socket, server_address, server_address_len);
     if (connect_status < 0) {
       if (errno == ECONNREFUSED)
       {
@@ -341,8 +459,18 @@ void dev_soft_interrupt(const char* irq_message) /*< send a software interrupt*/
 //------------------------------------------------------------------------------
 void dev_close(void)
 {
-  REPORT_INFO("Closing outgoing socket\n");
-  close(outgoing_socket);
+  (void)dev_complete_all();
+  free(retired);
+  retired          = NULL;
+  retired_capacity = 0;
+  if (shm != NULL) {
+    REPORT_INFO("Detaching shared memory\n");
+    tlmx_shm_detach(shm);
+    shm = NULL;
+  } else {
+    REPORT_INFO("Closing outgoing socket\n");
+    close(outgoing_socket);
+  }
 
   // stop the interrupt server
   server_stop = 1;
@@ -353,64 +481,273 @@ void dev_close(void)
 }/*end dev_close()*/
 
 //------------------------------------------------------------------------------
-int dev_transport
+// Pipelined transport. Each request is packed into a length-prefixed, tagged
+// frame (see tlmx_frame.h) held in the pending table at slot
+// tag%DEV_MAX_OUTSTANDING. Frames accumulate until dev_flush() hands them all
+// to the socket with one writev. Responses may arrive in any order and in any
+// segmentation; dev_receive() reassembles them and files them by tag.
+//------------------------------------------------------------------------------
+int dev_flush(void)
+{
+  struct iovec* iov = send_iov;
+  int           count = send_iov_count;
+  if (shm != NULL) {
+    /* Each iovec is one whole frame; the ring holds a full window of them */
+    for (; count > 0; ++iov, --count) {
+      tlmx_shm_ring_wait_space(&shm->to_sysc, iov->iov_len);
+      (void)tlmx_shm_ring_put(&shm->to_sysc, (const char*)iov->iov_base, iov->iov_len);
+    }
+    send_iov_count = 0;
+    return 0;
+  }
+  while (count > 0) {
+    ssize_t send_count = writev(outgoing_socket, iov, count);
+    if (send_count < 0) {
+      if (errno == EINTR) continue;
+      REPORT_ERROR("TCPIP write/send failed to send all data => %s\n",strerror(errno));
+      send_iov_count = 0;
+      return -1;
+    }
+    /* Skip what was written, which may end part way through a frame */
+    while (count > 0 && (size_t)send_count >= iov->iov_len) {
+      send_count -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = (char*)iov->iov_base + send_count;
+      iov->iov_len -= send_count;
+    }
+  }
+  send_iov_count = 0;
+  return 0;
+}/*end dev_flush()*/
+
+//------------------------------------------------------------------------------
+static char* dev_next_frame(int* frame_size_ptr) /*< whole frame from recv_ring or NULL */
+{
+  unsigned long buffered = recv_tail - recv_head;
+  unsigned long head     = recv_head % DEV_RECV_RING;
+  unsigned long first    = DEV_RECV_RING - head; /*< contiguous bytes before wrap */
+  char          header[TLMX_FRAME_HEADER_SIZE];
+  const char*   header_ptr = &recv_ring[head];
+  int           frame_size;
+  if (buffered < TLMX_FRAME_HEADER_SIZE) return NULL;
+  if (first < TLMX_FRAME_HEADER_SIZE) {
+    memcpy(header, &recv_ring[head], first);
+    memcpy(header+first, &recv_ring[0], TLMX_FRAME_HEADER_SIZE-first);
+    header_ptr = header;
+  }
+  frame_size = tlmx_frame_size(header_ptr);
+  if (!tlmx_frame_size_ok(frame_size)) {
+    REPORT_ERROR("Malformed response frame (%d bytes)\n",frame_size);
+    exit(1);
+  }
+  if (buffered < (unsigned long)frame_size) return NULL; /*< rest still in transit */
+  *frame_size_ptr = frame_size;
+  if (first >= (unsigned long)frame_size) return &recv_ring[head];
+  memcpy(recv_scratch, &recv_ring[head], first);
+  memcpy(recv_scratch+first, &recv_ring[0], frame_size-first);
+  return recv_scratch;
+}/*end dev_next_frame(...)*/
+
+//------------------------------------------------------------------------------
+static void dev_file_response(const char* frame) /*< match response frame to its request */
+{
+  dev_tag_t      tag  = tlmx_frame_tag(frame);
+  dev_pending_t* slot = &pending[tag % DEV_MAX_OUTSTANDING];
+  if (!slot->busy || slot->tag != tag || slot->done) {
+    REPORT_ERROR("Response with unexpected tag %u\n",tag);
+    return;
+  }
+  tlmx_packet* payload_recv_ptr = clone_tlmx_packet(slot->request);
+  unpack_tlmx(payload_recv_ptr,(char*)frame+TLMX_FRAME_HEADER_SIZE);
+  if (debug_level > 1) { print_tlmx(payload_recv_ptr,"Response"); }
+  slot->status = 0;
+  if (payload_recv_ptr->status != TLMX_OK_RESPONSE) {
+    if (payload_recv_ptr->command != TLMX_BATCH) { /*< batches report per operation */
+      REPORT_ERROR("%s(addr=%0llx) got %s\n"
+             , tlmx_command_to_str(payload_recv_ptr->command)
+             , payload_recv_ptr->address
+             , tlmx_status_to_str(payload_recv_ptr->status)
+             );
+    }
+    slot->status = -1;
+  }
+  delete_tlmx_packet(payload_recv_ptr);
+  slot->done = 1;
+}/*end dev_file_response(...)*/
+
+//------------------------------------------------------------------------------
+static int dev_receive_shm(void) /*< wait for responses in shared memory and file them */
+{
+  char* frame;
+  int   frame_size;
+  tlmx_shm_ring_wait_data(&shm->fm_sysc);
+  while ((frame = tlmx_shm_ring_peek(&shm->fm_sysc,recv_scratch,&frame_size)) != NULL) {
+    dev_file_response(frame);
+    tlmx_shm_ring_consume(&shm->fm_sysc,frame_size);
+  }
+  if (frame_size < 0) {
+    REPORT_ERROR("Malformed response frame in shared memory\n");
+    exit(1);
+  }
+  return 0;
+}/*end dev_receive_shm()*/
+
+//------------------------------------------------------------------------------
+static int dev_receive(void) /*< read available responses and file them by tag */
+{
+  unsigned long space = DEV_RECV_RING - (recv_tail - recv_head);
+  unsigned long tail  = recv_tail % DEV_RECV_RING;
+  unsigned long first = DEV_RECV_RING - tail;
+  struct iovec  iov[2];
+  ssize_t       recv_count;
+  if (shm != NULL) return dev_receive_shm();
+  if (first > space) first = space;
+  iov[0].iov_base = &recv_ring[tail];
+  iov[0].iov_len  = first;
+  iov[1].iov_base = &recv_ring[0];
+  iov[1].iov_len  = space - first;
+  recv_count = readv(outgoing_socket, iov, iov[1].iov_len ? 2 : 1);
+  if (recv_count <= 0) {
+    if (recv_count < 0 && errno == EINTR) return 0;
+    REPORT_ERROR("TCPIP read/recv didn't receive enough data\n");
+    return -1;
+  }
+  recv_tail += recv_count;
+
+  /* File every complete frame */
+  char* frame;
+  int   frame_size;
+  while ((frame = dev_next_frame(&frame_size)) != NULL) {
+    recv_head += frame_size;
+    dev_file_response(frame);
+  }
+  return 0;
+}/*end dev_receive()*/
+
+//------------------------------------------------------------------------------
+static void dev_retire(dev_tag_t tag, int status) /*< keep status until collected */
+{
+  if (retired_count == retired_capacity) {
+    size_t         capacity = retired_capacity ? 2*retired_capacity : DEV_MAX_OUTSTANDING;
+    dev_retired_t* grown    = realloc(retired, capacity*sizeof(dev_retired_t));
+    if (grown == NULL) {
+      REPORT_ERROR("Out of memory retiring request %u\n",tag);
+      exit(1);
+    }
+    retired          = grown;
+    retired_capacity = capacity;
+  }
+  retired[retired_count].tag    = tag;
+  retired[retired_count].status = status;
+  ++retired_count;
+}/*end dev_retire(...)*/
+
+//------------------------------------------------------------------------------
+int dev_complete(dev_tag_t tag)
+{
+  dev_pending_t* slot = &pending[tag % DEV_MAX_OUTSTANDING];
+  if (!slot->busy || slot->tag != tag) {
+    size_t i;
+    for (i = 0; i != retired_count; ++i) {
+      if (retired[i].tag == tag) {
+        int status = retired[i].status;
+        retired[i] = retired[--retired_count];
+        return status;
+      }
+    }
+    REPORT_ERROR("No outstanding request with tag %u\n",tag);
+    return -1;
+  }
+  if (!slot->done && send_iov_count > 0 && dev_flush() < 0) {
+    slot->status = -1;
+    slot->done   = 1;
+  }
+  while (!slot->done) {
+    if (dev_receive() < 0) {
+      slot->status = -1;
+      break;
+    }
+  }
+  delete_tlmx_packet(slot->request);
+  slot->request = NULL;
+  slot->busy    = 0;
+  return slot->status;
+}/*end dev_complete(...)*/
+
+//------------------------------------------------------------------------------
+int dev_complete_all(void)
+{
+  int status = 0;
+  /* Oldest first */
+  for (dev_tag_t tag = next_tag - DEV_MAX_OUTSTANDING; tag != next_tag; ++tag) {
+    dev_pending_t* slot = &pending[tag % DEV_MAX_OUTSTANDING];
+    if (slot->busy && slot->tag == tag && dev_complete(tag) < 0) status = -1;
+  }
+  while (retired_count > 0) {
+    if (retired[--retired_count].status < 0) status = -1;
+  }
+  return status;
+}/*end dev_complete_all()*/
+
+//------------------------------------------------------------------------------
+static int dev_issue
 ( tlmx_command_t  command
 , addr_t  address
 , dlen_t  data_len
 , data_t* data_ptr
+, dev_tag_t* tag_ptr
 )
 {
-  int          status = 0;
-  tlmx_packet* payload_send_ptr = NULL;
-  char         send_message[TLMX_MAX_BUFFER];
-  tlmx_packet* payload_recv_ptr = NULL;
-  char         server_reply[TLMX_MAX_BUFFER];
+  dev_tag_t      tag  = next_tag;
+  dev_pending_t* slot = &pending[tag % DEV_MAX_OUTSTANDING];
+  int            packed_size;
+
+  /* Window full: wait for the oldest request and free its slot, keeping its
+   * status for the caller's own dev_complete() */
+  if (slot->busy) {
+    dev_tag_t oldest = slot->tag;
+    dev_retire(oldest, dev_complete(oldest));
+  }
 
   /* Compose transaction */
-  payload_send_ptr = new_tlmx_packet( command
-                                    , address
-                                    , data_len
-                                    , data_ptr
-                                    );
-  if (debug_level > 1) { print_tlmx(payload_send_ptr,"Request"); }
-  memset(send_message,0,TLMX_MAX_BUFFER);
-  int send_message_size;
-  send_message_size = pack_tlmx(send_message,payload_send_ptr);
-
-  /* Send to SystemC server */
-//REPORT_DEBUG("Sending transaction request\n");
-  int send_count;
-  send_count = write(outgoing_socket, send_message, send_message_size);
-  if (send_count < 0) {
-    REPORT_ERROR("TCPIP write/send failed to send all data\n");
-  }
-  assert(send_count == send_message_size);
-  
-//REPORT_DEBUG("Obtaining transaction response\n");
-  memset(server_reply,0,TLMX_MAX_BUFFER);
-  int recv_message_size;
-  recv_message_size = send_message_size;
-  int recv_count;
-  recv_count = read(outgoing_socket, server_reply, recv_message_size);
-  if (recv_count < 0) {
-    REPORT_ERROR("TCPIP read/recv didn't receive enough data\n");
-  }
-  assert(recv_count == recv_message_size);
-  payload_recv_ptr = clone_tlmx_packet(payload_send_ptr);
-  unpack_tlmx(payload_recv_ptr,server_reply);
+  slot->request = new_tlmx_packet( command
+                                 , address
+                                 , data_len
+                                 , data_ptr
+                                 );
+  if (debug_level > 1) { print_tlmx(slot->request,"Request"); }
+  memset(slot->frame,0,TLMX_MAX_FRAME);
+  packed_size = pack_tlmx(slot->frame+TLMX_FRAME_HEADER_SIZE,slot->request);
+  tlmx_frame_set_header(slot->frame,packed_size,tag);
+  slot->tag    = tag;
+  slot->busy   = 1;
+  slot->done   = 0;
+  slot->status = 0;
+  ++next_tag;
+  if (tag_ptr != NULL) *tag_ptr = tag;
+
+  /* Queue for the SystemC server; dev_flush/dev_complete sends it */
+//REPORT_DEBUG("Queueing transaction request\n");
+  send_iov[send_iov_count].iov_base = slot->frame;
+  send_iov[send_iov_count].iov_len  = TLMX_FRAME_HEADER_SIZE + packed_size;
+  ++send_iov_count;
+  return 0;
+}/*end dev_issue(...)*/
 
-  if (debug_level > 1) { print_tlmx(payload_recv_ptr,"Response"); }
-  if (payload_recv_ptr->status != TLMX_OK_RESPONSE) {
-    REPORT_ERROR("%s(addr=%0llx) got %s\n"
-           , tlmx_command_to_str(payload_recv_ptr->command)
-           , payload_recv_ptr->address
-           , tlmx_status_to_str(payload_recv_ptr->status)
-           );
-    status = -1;
-  }
-  delete_tlmx_packet(payload_send_ptr);
-  delete_tlmx_packet(payload_recv_ptr);
-  return status;
+//------------------------------------------------------------------------------
+int dev_transport
+( tlmx_command_t  command
+, addr_t  address
+, dlen_t  data_len
+, data_t* data_ptr
+)
+{
+  dev_tag_t tag;
+  (void)dev_issue(command, address, data_len, data_ptr, &tag);
+  return dev_complete(tag);
 }/*end dev_transport(...)*/
 
 //------------------------------------------------------------------------------
@@ -425,6 +762,24 @@ int dev_get ( addr_t  address , data_t* data_ptr , dlen_t  data_len )
   return dev_transport( TLMX_READ, address, data_len, data_ptr );
 }/*end dev_get(...)*/
 
+//------------------------------------------------------------------------------
+int dev_fence ( void )
+{
+  return dev_transport( TLMX_FENCE, 0, 0, NULL );
+}/*end dev_fence(...)*/
+
+//------------------------------------------------------------------------------
+int dev_put_async ( addr_t  address , data_t* data_ptr , dlen_t  data_len , dev_tag_t* tag_ptr )
+{
+  return dev_issue( TLMX_WRITE, address, data_len, data_ptr, tag_ptr );
+}/*end dev_put_async(...)*/
+
+//------------------------------------------------------------------------------
+int dev_get_async ( addr_t  address , data_t* data_ptr , dlen_t  data_len , dev_tag_t* tag_ptr )
+{
+  return dev_issue( TLMX_READ, address, data_len, data_ptr, tag_ptr );
+}/*end dev_get_async(...)*/
+
 //------------------------------------------------------------------------------
 int dev_put_debug ( addr_t  address , data_t* data_ptr , dlen_t  data_len )
 {
@@ -437,6 +792,96 @@ int dev_get_debug ( addr_t  address , data_t* data_ptr , dlen_t  data_len )
   return dev_transport( TLMX_DEBUG_READ, address, data_len, data_ptr );
 }/*end dev_get_debug(...)*/
 
+//------------------------------------------------------------------------------
+// Batched transport. Operations are encoded back to back into batch_data and
+// sent as a single TLMX_BATCH packet whose address is the operation count.
+// The response carries every operation's status and read data in place.
+//------------------------------------------------------------------------------
+static int dev_batch_send(void) /*< transport current batch and distribute results */
+{
+  int status = 0;
+  if (batch_count == 0) return 0;
+  (void)dev_transport( TLMX_BATCH, batch_count, batch_used, batch_data );
+  for (int i=0; i!=batch_count; ++i) {
+    char*          op      = (char*)&batch_data[batch_op[i].offset];
+    tlmx_command_t command = tlmx_batch_command(op);
+    if (tlmx_batch_status(op) != TLMX_OK_RESPONSE) {
+      REPORT_ERROR("%s(addr=%0llx) got %s\n"
+             , tlmx_command_to_str(command)
+             , (unsigned long long)tlmx_batch_address(op)
+             , tlmx_status_to_str(tlmx_batch_status(op))
+             );
+      status = -1;
+    } else if (command == TLMX_READ || command == TLMX_DEBUG_READ) {
+      memcpy(batch_op[i].data_ptr, op+TLMX_BATCH_OP_HEADER_SIZE, tlmx_batch_data_len(op));
+    }
+  }
+  batch_used  = 0;
+  batch_count = 0;
+  return status;
+}/*end dev_batch_send()*/
+
+//------------------------------------------------------------------------------
+static int dev_batch_add
+( tlmx_command_t  command
+, addr_t  address
+, dlen_t  data_len
+, data_t* data_ptr
+)
+{
+  int   size = TLMX_BATCH_OP_HEADER_SIZE + data_len;
+  char* op;
+  if (size > TLMX_MAX_DATA_LEN) {
+    REPORT_ERROR("Batch operation too large (%u bytes)\n",(unsigned)data_len);
+    return -1;
+  }
+  /* Full: send what we have and carry on with an empty batch */
+  if (batch_used + size > TLMX_MAX_DATA_LEN || batch_count == DEV_MAX_BATCH_OPS) {
+    if (dev_batch_send() < 0) batch_status = -1;
+  }
+  op = (char*)&batch_data[batch_used];
+  tlmx_batch_set_op(op, command, address, data_len);
+  if (command == TLMX_WRITE || command == TLMX_DEBUG_WRITE) {
+    memcpy(op+TLMX_BATCH_OP_HEADER_SIZE, data_ptr, data_len);
+  } else {
+    memset(op+TLMX_BATCH_OP_HEADER_SIZE, 0, data_len);
+  }
+  batch_op[batch_count].data_ptr = data_ptr;
+  batch_op[batch_count].offset   = batch_used;
+  batch_used += size;
+  ++batch_count;
+  return 0;
+}/*end dev_batch_add(...)*/
+
+//------------------------------------------------------------------------------
+void dev_batch_begin(void)
+{
+  batch_used   = 0;
+  batch_count  = 0;
+  batch_status = 0;
+}/*end dev_batch_begin()*/
+
+//------------------------------------------------------------------------------
+int dev_batch_put ( addr_t  address , data_t* data_ptr , dlen_t  data_len )
+{
+  return dev_batch_add( TLMX_WRITE, address, data_len, data_ptr );
+}/*end dev_batch_put(...)*/
+
+//------------------------------------------------------------------------------
+int dev_batch_get ( addr_t  address , data_t* data_ptr , dlen_t  data_len )
+{
+  return dev_batch_add( TLMX_READ, address, data_len, data_ptr );
+}/*end dev_batch_get(...)*/
+
+//------------------------------------------------------------------------------
+int dev_batch_end(void)
+{
+  int status = dev_batch_send();
+  if (batch_status < 0) status = -1;
+  batch_status = 0;
+  return status;
+}/*end dev_batch_end()*/
+
 //------------------------------------------------------------------------------
 void dev_wait(void)
 {
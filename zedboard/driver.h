@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 #include "creport.h"
+#include "tlmx_frame.h"
 
 #define DEV_BASE       0 /*0x8000FF080100*/
 #define DEV_STATUS_REG (DEV_BASE + 0*4)
@@ -28,14 +29,40 @@
 typedef uint64_t      addr_t;
 typedef unsigned char data_t;
 typedef uint16_t      dlen_t;
+typedef uint32_t      dev_tag_t;
+
+#define DEV_MAX_OUTSTANDING TLMX_MAX_WINDOW /*< requests in flight before dev_*_async blocks */
+
+#define DEV_UNIX_PATH_MAX 100 /*< leaves room for ".irq" within sun_path */
 
 // Return values: 0=SUCCESS; -1=FAILURE
+// A hostname beginning with '/' is the path of the simulator's AF_UNIX socket
+// (async_adaptor -socket=PATH); hostport is then unused.
 void    dev_open(char* hostname, int hostport);
 void    dev_close(void);
 int     dev_put( addr_t  address , data_t* data_ptr , dlen_t  data_len );
 int     dev_get( addr_t  address , data_t* data_ptr , dlen_t  data_len );
 int     dev_put_debug ( addr_t  address , data_t* data_ptr , dlen_t  data_len );
 int     dev_get_debug ( addr_t  address , data_t* data_ptr , dlen_t  data_len );
+// Pipelined versions return as soon as the request is queued. Queued requests
+// go out together on dev_flush() or the next dev_complete(). data_ptr must stay
+// valid until dev_complete() of the returned tag (or dev_complete_all()). With
+// DEV_MAX_OUTSTANDING in flight, a new request first waits for the oldest; its
+// status is kept until that tag is completed.
+int     dev_put_async ( addr_t  address , data_t* data_ptr , dlen_t  data_len , dev_tag_t* tag_ptr );
+int     dev_get_async ( addr_t  address , data_t* data_ptr , dlen_t  data_len , dev_tag_t* tag_ptr );
+int     dev_flush( void );             // send queued requests without waiting
+int     dev_complete( dev_tag_t tag ); // wait for tag's response and return its status
+int     dev_complete_all( void );      // wait for every outstanding request
+int     dev_fence( void );             // wait until earlier writes are performed; their first error, if any
+// Batches gather several accesses into one TLMX_BATCH request so SystemC
+// performs them in a single activation and a single round trip. Operations run
+// in the order given; read data lands in data_ptr when dev_batch_end() returns.
+// A batch too large for one packet is sent in pieces transparently.
+void    dev_batch_begin( void );
+int     dev_batch_put( addr_t  address , data_t* data_ptr , dlen_t  data_len );
+int     dev_batch_get( addr_t  address , data_t* data_ptr , dlen_t  data_len );
+int     dev_batch_end( void );         // send, wait and return 0 iff every operation succeeded
 void    dev_soft_interrupt(const char* irq_message);
 void    dev_wait(void); // wait for "interrupt"
 debug_t dev_debug(long long int level); // if <0 then read else set level (default 0 => off)
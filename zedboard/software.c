@@ -39,11 +39,11 @@ int main(int argc, char* argv[])
   //----------------------------------------------------------------------------
   // Parse command-line
   //----------------------------------------------------------------------------
-  if (argc != 3) {
-    REPORT_ERROR("Syntax: %s HOSTNAME PORTNUMBER\n",argv[0]);
-  }
-  port = strtol(argv[2],&endptr,10);
-  if (port == 0L) {
+  if (argc == 2 && argv[1][0] == '/') {
+    /* SOCKETPATH: same-host AF_UNIX connection, no port required */
+  } else if (argc != 3) {
+    REPORT_ERROR("Syntax: %s HOSTNAME PORTNUMBER | %s SOCKETPATH\n",argv[0],argv[0]);
+  } else if ((port = strtol(argv[2],&endptr,10)) == 0L) {
     REPORT_ERROR("Unable to parse port number.\n");
   } else if (port < 2000 || port > 65535) {
     REPORT_ERROR("Bad port number (%ld) specified. Port number restricted to between 2000 and 65535.\n",port);
@@ -66,33 +66,39 @@ int main(int argc, char* argv[])
   // Perform TESTCNT tests
   //----------------------------------------------------------------------------
   int data;
+  int wdata[REGCNT];      /*< must outlive the batch */
+  int rdata[REGCNT];
   for (int i=0; i!=TESTCNT; ++i) {
-    /* Write to all registers */
+    /* One batch per test: write all registers, then read status and counts */
+    dev_batch_begin();
     for (int t=0; t!=REGCNT; ++t) {
 //    if (count[t] != 0) break; /*< not yet done */
 //    if (random()&1) break; /* 50% chance */
-      data = abs(random()%5000) + 1000; /*< 1000..5999 */
+      wdata[t] = abs(random()%5000) + 1000; /*< 1000..5999 */
 //    REPORT_DEBUG("Attempting to put...\n");
-      if (dev_put(DEV_COUNT1_REG+4*t,(unsigned char*)(&data),sizeof(data))<0) {
-        REPORT_ERROR("Unable to set DEV_COUNT%d\n",t+1);
-      } else {
-        count[t] = data; /*< indicate in progress */
+      if (dev_batch_put(DEV_COUNT1_REG+4*t,(unsigned char*)(&wdata[t]),sizeof(wdata[t]))<0) {
+        REPORT_ERROR("Unable to send DEV_COUNT%d\n",t+1);
       }
     }//endfor t=0..REGCNT-1
     //dev_wait();
     /* Check status */
-    if (dev_get(DEV_STATUS_REG,(unsigned char*)(&data),sizeof(data))<0) {
-      REPORT_ERROR("Unable to get DEV_STATUS\n");
+    if (dev_batch_get(DEV_STATUS_REG,(unsigned char*)(&data),sizeof(data))<0) {
+      REPORT_ERROR("Unable to request DEV_STATUS\n");
     }
-    REPORT_INFO("Status = %04x\n",data);
     for (int t=0; t!=REGCNT; ++t) {
-      if (dev_get(DEV_COUNT1_REG+4*t,(unsigned char*)(&data),sizeof(data))<0) {
-        REPORT_ERROR("Unable to get DEV_COUNT%d\n",t+1);
-      } else {
-        REPORT_INFO("DEV_COUNT%d = %04x\n",t+1,data);
-        count[t] = data; /*< indicate current value */
+      if (dev_batch_get(DEV_COUNT1_REG+4*t,(unsigned char*)(&rdata[t]),sizeof(rdata[t]))<0) {
+        REPORT_ERROR("Unable to request DEV_COUNT%d\n",t+1);
       }
     }//endfor t=0..REGCNT-1
+    if (dev_batch_end()<0) {
+      REPORT_ERROR("Batch of DEV_COUNT/DEV_STATUS accesses failed\n");
+      continue;
+    }
+    REPORT_INFO("Status = %04x\n",data);
+    for (int t=0; t!=REGCNT; ++t) {
+      REPORT_INFO("DEV_COUNT%d = %04x\n",t+1,rdata[t]);
+      count[t] = rdata[t]; /*< indicate current value */
+    }//endfor t=0..REGCNT-1
   }//endfor i=0..19
 
   //----------------------------------------------------------------------------
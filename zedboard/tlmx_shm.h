@@ -0,0 +1 @@
+../include/tlmx_shm.h
\ No newline at end of file